@@ -57,6 +57,7 @@ endmacro()
 macro(sproutpp_setup_options)
     option(sproutpp_ENABLE_HARDENING "Enable hardening" ON)
     option(sproutpp_ENABLE_COVERAGE "Enable coverage reporting" OFF)
+    option(sproutpp_BUILD_BENCHMARKS "Build the benchmarks and register a short run with CTest" OFF)
     cmake_dependent_option(
             sproutpp_ENABLE_GLOBAL_HARDENING
             "Attempt to push hardening options to built dependencies"
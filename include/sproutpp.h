@@ -2,8 +2,16 @@
 
 #include <sproutpp/application_context.h>
 #include <sproutpp/property_resolver.h>
+#include <sproutpp/property_handle.h>
 #include <sproutpp/property_source.h>
+#include <sproutpp/property_view.h>
+#include <sproutpp/typed_value.h>
 #include <sproutpp/bean_factory.h>
+#include <sproutpp/bean_ref.h>
+#include <sproutpp/bean_pool.h>
+#include <sproutpp/request_scope.h>
+#include <sproutpp/static_context.h>
 #include <sproutpp/application_context_aware.h>
 #include <sproutpp/bean_factory_aware.h>
 #include <sproutpp/bean_name_aware.h>
+#include <sproutpp/resettable_bean.h>
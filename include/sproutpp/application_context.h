@@ -5,7 +5,9 @@
 #include "property_resolver.h"
 
 #include <algorithm>
+#include <memory>
 #include <set>
+#include <string>
 
 namespace framework {
 
@@ -21,6 +23,20 @@ public:
   
   virtual ApplicationContext *getParentContext() const = 0;
 
+  /**
+   * \brief Creates a context that only holds its own beans and property sources, and falls back
+   * to this context for anything it cannot resolve itself.
+   *
+   * Meant to be created in large numbers (per tenant, per request): the child shares this
+   * context's logger and active profiles and reads no command line, environment nor file. It
+   * caches what it resolved through this context, and keeps it alive when it is owned by a
+   * shared_ptr; otherwise this context must outlive the child.
+   *
+   * \param name name of the child context.
+   * \return the child context, not initialized.
+   */
+  virtual std::shared_ptr<ApplicationContext> createChildContext(std::string name) = 0;
+
   /**
    * \brief Initializes the context with discovered values
    *
@@ -1,8 +1,20 @@
 
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <cstdint>
 #include <functional>
+#include <iterator>
 #include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/type_index/ctti_type_index.hpp>
 
@@ -12,29 +24,295 @@
 
 namespace framework {
 
+template<typename Tp>
+class BeanRef;
+
+template<typename Tp>
+class BeanPool;
+
+template<typename... Beans>
+class StaticContext;
+
+/**
+ * Interfaces a bean can be looked up by, besides its own type, as a std::tuple of base classes.
+ *
+ * Declare `using BeanInterfaces = std::tuple<Base...>;` in the bean class, or specialize this
+ * trait for types that cannot be changed.
+ */
+template<typename Tp, typename = void>
+struct BeanInterfaces {
+  using type = std::tuple<>;
+};
+
+template<typename Tp>
+struct BeanInterfaces<Tp, std::void_t<typename Tp::BeanInterfaces>> {
+  using type = typename Tp::BeanInterfaces;
+};
+
+/**
+ * Scopes of the beans handed out by BeanFactory::getScopedBean.
+ */
+enum class BeanScope {
+  /// One instance per thread, destroyed when the thread exits or, on the thread destroying the
+  /// factory, when the factory goes away first
+  THREAD,
+  /// One instance per RequestScope, destroyed when the scope ends
+  REQUEST,
+};
+
+/**
+ * Instances of a single scope (a thread, a request), at most one per bean type.
+ *
+ * Only ever used by the thread the scope belongs to, so lookups take no lock: they index a vector
+ * by BeanType id. Instances are allocated from an arena owned by the scope and destroyed together,
+ * newest first, when the scope is cleared.
+ */
+class ScopedBeans {
+  struct Entry {
+    void *bean = nullptr;
+    void (*destroy)(void *bean) = nullptr;
+  };
+
+  std::pmr::monotonic_buffer_resource _arena;
+  /// Indexed by BeanType id
+  std::vector<Entry> _beans;
+  /// Type ids, in creation order
+  std::vector<std::size_t> _created;
+
+public:
+  ScopedBeans() = default;
+  ScopedBeans(const ScopedBeans &) = delete;
+  ScopedBeans &operator=(const ScopedBeans &) = delete;
+  ~ScopedBeans() { clear(); }
+
+  /// \return the instance of a type in this scope, nullptr if there is none yet.
+  void *find(std::size_t type) const noexcept { return type < _beans.size() ? _beans[type].bean : nullptr; }
+
+  /**
+   * Builds the instance of a type in this scope, its constructor may create other scoped beans.
+   */
+  template<typename Tp>
+  Tp *create(std::size_t type) {
+    const auto bean = std::pmr::polymorphic_allocator<>(&_arena).new_object<Tp>();
+    if (type >= _beans.size()) {
+      _beans.resize(type + 1);
+    }
+    _beans[type] = {bean, [](void *ptr) { std::destroy_at(static_cast<Tp *>(ptr)); }};
+    _created.push_back(type);
+    return bean;
+  }
+
+  /**
+   * Destroys every instance, newest first, and releases their memory at once.
+   */
+  void clear() {
+    while (!_created.empty()) {
+      auto &entry = _beans[_created.back()];
+      _created.pop_back();
+      entry.destroy(std::exchange(entry.bean, nullptr));
+    }
+    _arena.release();
+  }
+};
+
+/**
+ * Type-erased base of BeanPool, so factories can own the pools of every type.
+ */
+class BeanPoolBase {
+protected:
+  /// Number of per-thread free lists of a pool
+  static constexpr std::size_t THREAD_SLOTS = 16;
+
+  /// Free list of the calling thread; slots are handed out round robin to new threads.
+  static std::size_t threadSlot() noexcept;
+
+public:
+  virtual ~BeanPoolBase() = default;
+};
+
 /**
  * Interface of the lightweight IoC container used across the framework.
  *
  * BeanFactory owns the lifetime of all beans registered within it and provides:
- * - Construction of singleton beans (createSingleton),
+ * - Construction of singleton beans (createSingleton), now or on first lookup (defineLazyBean),
+ *   or during initialization after the beans they depend on (defineBean),
  * - Registration of externally constructed instances (registerExistingBean),
- * - Lookup by name and by type (getBeanTyped, getFirstBeanTyped),
+ * - Lookup by name and by type (getBeanTyped, getFirstBeanTyped, getBeansTyped),
+ * - Pools of recycled prototype instances (getBeanPool, getPooledInstance),
+ * - Per-thread and per-request instances (getScopedBean),
  * - Hooking of environment-aware interfaces (ApplicationContextAware, BeanFactoryAware).
  *
  * Notes on ownership and destruction order:
  * - For beans constructed/registered through this factory, the factory is responsible for calling the
- *   correct deleter when the concrete implementation decides to destroy the bean. The concrete
- *   implementation must invoke deleteBean(void*) prior to actually destroying object memory, so that
- *   the allocator-aware destroy() can be called afterwards by the generated deleter.
+ *   BeanOps registered with the bean when the concrete implementation decides to destroy it. The
+ *   concrete implementation must invoke deleteBean(void*) prior to actually destroying object memory,
+ *   then call BeanOps::destroy and BeanOps::deallocate.
  * - The actual storage and mapping between types/names is implementation-defined and provided by
  *   a concrete subclass.
  */
 class BeanFactory {
+  template<typename Tp>
+  friend class BeanRef;
+  template<typename Tp>
+  friend class BeanPool;
+  template<typename... Beans>
+  friend class StaticContext;
+
+  /// Hands out the next dense bean type id; ids start at 0 and are never reused.
+  static std::size_t nextBeanTypeId() noexcept;
+
 protected:
-  /// Type-erased deleter used by the factory to destroy stored beans.
-  using deleter_t = std::function<void(void *)>;
-  /// Compact compile-time type identifier used as the key for type-based lookups.
-  using BeanType = boost::typeindex::ctti_type_index;
+  /**
+   * Per-type operations used to release a bean.
+   *
+   * There is a single static table per bean type and allocation kind, so the registry only keeps a
+   * pointer to it instead of a type-erased callable per bean.
+   */
+  struct BeanOps {
+    /// Runs the destructor of the bean (and frees it, for beans that own their allocation)
+    void (*destroy)(void *bean);
+    /// Releases the memory of a destroyed bean back to the resource passed to registerBean
+    void (*deallocate)(void *bean, std::pmr::memory_resource *resource);
+
+    /// Operations for a bean allocated from a memory resource (createSingleton, getNewInstance)
+    template<typename Tp>
+    static const BeanOps *allocated() {
+      static constexpr BeanOps ops{
+          [](void *bean) { std::destroy_at(static_cast<Tp *>(bean)); },
+          [](void *bean, std::pmr::memory_resource *resource) {
+            std::pmr::polymorphic_allocator<Tp>(resource).deallocate(static_cast<Tp *>(bean), 1);
+          }};
+      return &ops;
+    }
+
+    /// Operations for a bean handed over in a std::unique_ptr (registerExistingBean)
+    template<typename Tp>
+    static const BeanOps *owned() {
+      static constexpr BeanOps ops{
+          [](void *bean) { std::default_delete<Tp>{}(static_cast<Tp *>(bean)); },
+          [](void *, std::pmr::memory_resource *) {}};
+      return &ops;
+    }
+
+    /// Operations for a bean whose lifetime is managed elsewhere (StaticContext::exposeTo)
+    static const BeanOps *unowned() {
+      static constexpr BeanOps ops{[](void *) {}, [](void *, std::pmr::memory_resource *) {}};
+      return &ops;
+    }
+  };
+
+  /**
+   * Deferred construction of a bean defined through defineLazyBean.
+   *
+   * The storage of the bean is allocated and registered up front; the implementation calls
+   * ensureConstructed when a lookup hands out the bean. Concurrent first lookups build it exactly
+   * once, the others wait for it. If the factory callable throws, the next lookup tries again.
+   */
+  class LazyBean {
+    std::once_flag _once;
+    std::atomic<bool> _constructed{false};
+    bool _eager = false;
+    std::vector<std::string> _depends_on;
+
+  protected:
+    /// Builds the bean in its storage and wires its framework-aware dependencies
+    virtual void construct(void *bean, BeanFactory &factory) = 0;
+
+  public:
+    LazyBean() = default;
+    LazyBean(const LazyBean &) = delete;
+    LazyBean &operator=(const LazyBean &) = delete;
+    virtual ~LazyBean() = default;
+
+    /// Whether the bean was built; until then it must not be destroyed, only deallocated.
+    bool constructed() const noexcept { return _constructed.load(std::memory_order_acquire); }
+
+    /// Marks the bean to be built during initialization, after the beans named in dependsOn.
+    void setEager(std::vector<std::string> dependsOn) {
+      _eager = true;
+      _depends_on = std::move(dependsOn);
+    }
+
+    bool eager() const noexcept { return _eager; }
+    const std::vector<std::string> &dependsOn() const noexcept { return _depends_on; }
+
+    /**
+     * Builds the bean unless that was already done, or seal() was called.
+     *
+     * \return true only for the call that actually built the bean.
+     */
+    bool ensureConstructed(void *bean, BeanFactory &factory) {
+      auto built = false;
+      if (!constructed()) {
+        std::call_once(_once, [&] {
+          construct(bean, factory);
+          _constructed.store(true, std::memory_order_release);
+          built = true;
+        });
+      }
+      return built;
+    }
+
+    /**
+     * Makes sure the bean is not built from now on, waiting for a build in progress to finish.
+     * Called once the bean is unregistered, before its storage is released.
+     *
+     * \return whether the bean was built, and must be destroyed.
+     */
+    bool seal() {
+      std::call_once(_once, [] {});
+      return constructed();
+    }
+  };
+
+  /// LazyBean building a Tp from the callable given to defineLazyBean
+  template<typename Tp, typename Factory>
+  class LazyBeanOf final : public LazyBean {
+    Factory _factory;
+
+  protected:
+    void construct(void *bean, BeanFactory &factory) override {
+      Tp *ptr;
+      if constexpr (std::invocable<Factory &, BeanFactory &>) {
+        ptr = ::new (bean) Tp(std::invoke(_factory, factory));
+      } else {
+        ptr = ::new (bean) Tp(std::invoke(_factory));
+      }
+      factory.handleBeanDependencies(ptr);
+    }
+
+  public:
+    explicit LazyBeanOf(Factory factory) : _factory(std::move(factory)) {}
+  };
+
+  /**
+   * Compact type identifier used as the key for type-based lookups.
+   *
+   * Each bean type is assigned a dense integer id the first time it is seen, so implementations
+   * can index per-type tables directly instead of comparing type names. The compile-time type
+   * name is kept alongside for default bean naming.
+   */
+  class BeanType {
+    std::size_t _id;
+    boost::typeindex::ctti_type_index _index;
+
+    BeanType(std::size_t id, boost::typeindex::ctti_type_index index) : _id(id), _index(index) {}
+
+  public:
+    template<typename Tp>
+    static BeanType type_id() {
+      static const std::size_t id = nextBeanTypeId();
+      return {id, boost::typeindex::ctti_type_index::type_id<Tp>()};
+    }
+
+    /// Dense id of this type, suitable as an index into per-type tables.
+    std::size_t id() const noexcept { return _id; }
+
+    /// Compile-time name of this type.
+    const char *name() const noexcept { return _index.name(); }
+
+    bool operator==(const BeanType &other) const noexcept { return _id == other._id; }
+  };
 
   /**
    * Hook invoked when a bean implementing ApplicationContextAware is created/registered.
@@ -47,8 +325,8 @@ protected:
   /**
    * Implementation-defined destruction bookkeeping for a bean instance.
    *
-   * This function is called by the type-erased deleter before the object's destructor is invoked
-   * (see makeDeleter). Concrete factories can use this to remove internal indices, break dependency
+   * This function must be called before the object's destructor is invoked (see BeanOps).
+   * Concrete factories can use this to remove internal indices, break dependency
    * links, etc.
    *
    * \param bean raw pointer to the bean to be deleted (non-owning).
@@ -60,11 +338,26 @@ protected:
    *
    * \param type   the compile-time type id for the bean (cv removed).
    * \param bean   pointer to the storage where the bean will live; ownership transferred to factory.
-   * \param deleter type-erased deleter to be used when removing the bean from the factory.
-   * \param name   unique bean name within this factory. Implementations may enforce uniqueness.
+   * \param ops    static operations used to destroy and deallocate the bean.
+   * \param resource memory resource the bean was allocated from; nullptr if it owns its allocation.
+   * \param name   unique bean name within this factory, copied by the implementation if it needs to
+   *               keep it. Implementations may enforce uniqueness.
+   * \return true if the bean was successfully registered; false if a conflict or error occurred.
+   */
+  virtual bool registerBean(const BeanType &type, void *bean, const BeanOps *ops, std::pmr::memory_resource *resource, std::string_view name) = 0;
+
+  /**
+   * Registers the storage of a bean that is built on its first lookup.
+   *
+   * Same as registerBean, except that the bean is not constructed yet: lookups returning it must
+   * call LazyBean::ensureConstructed first, and while it was not built the implementation must not
+   * run BeanOps::destroy on it, only BeanOps::deallocate.
+   *
+   * \param lazy   builds the bean; owned by the implementation on success.
    * \return true if the bean was successfully registered; false if a conflict or error occurred.
    */
-  virtual bool registerBean(const BeanType &type, void *bean, deleter_t deleter, std::string &&name) = 0;
+  virtual bool registerLazyBean(const BeanType &type, void *bean, const BeanOps *ops, std::pmr::memory_resource *resource,
+                                std::string_view name, std::unique_ptr<LazyBean> lazy) = 0;
 
   /**
    * Looks up a bean by name and type.
@@ -76,43 +369,220 @@ protected:
   virtual void *getBeanTypeByName(const BeanType &type, std::string_view view) = 0;
 
   /**
-   * Retrieves the first bean registered for a given type.
+   * Retrieves the first bean registered for a given type, or else the first one registered under
+   * it as an interface.
    *
    * \param type expected type identifier.
    * \return pointer to the bean if at least one exists, otherwise nullptr.
    */
   virtual void *getFirstBeanOfType(const BeanType &type) = 0;
 
+  /**
+   * Retrieves all the beans registered for a given type, in registration order, followed by the
+   * ones registered under it as an interface.
+   *
+   * \param type expected type identifier.
+   * \return the matching beans; empty if there are none.
+   */
+  virtual std::vector<void *> getBeansOfType(const BeanType &type) = 0;
+
+  /**
+   * Returns the generation counter guarding the answer of getFirstBeanOfType for a type.
+   *
+   * The counter is bumped every time the first bean of the type changes (first registration,
+   * deletion of the first bean). It must stay valid for the lifetime of the factory so that
+   * BeanRef can cache the resolved bean and only revalidate it with a single load.
+   *
+   * \param type expected type identifier.
+   * \return the generation counter for this type.
+   */
+  virtual const std::atomic<std::uint64_t> &firstBeanGeneration(const BeanType &type) = 0;
+
+  /// Converts a bean to a pointer to one of its interfaces, only once the bean is constructed
+  using AdjustToInterface = void *(*)(void *bean);
+
+  template<typename Tp, typename Interface>
+  static void *adjustToInterface(void *bean) {
+    return static_cast<Interface *>(static_cast<Tp *>(bean));
+  }
+
+  /**
+   * Indexes a registered bean under one of its interfaces (see BeanInterfaces).
+   *
+   * Called once the bean is registered: a lazy bean is indexed before it is built, and lookups
+   * for the interface build it as they do for its own type. getFirstBeanOfType and getBeansOfType
+   * for the interface type then also return the bean, after the beans registered with exactly that
+   * type. Implementations ignore beans they do not know (pooled or scoped instances), and
+   * interfaces a bean is already indexed under.
+   *
+   * \param bean          the bean, as registered.
+   * \param interfaceType type identifier of the interface.
+   * \param adjust        converts the constructed bean to a pointer to the interface.
+   */
+  virtual void registerBeanInterface(void *bean, const BeanType &interfaceType, AdjustToInterface adjust) = 0;
+
+  template<typename Tp, typename... Interfaces>
+  void registerBeanInterfaces(Tp *bean, std::tuple<Interfaces...> *) {
+    static_assert((std::is_base_of_v<Interfaces, Tp> && ...), "bean interfaces must be base classes of the bean");
+    (registerBeanInterface(bean, BeanType::type_id<Interfaces>(), &adjustToInterface<Tp, Interfaces>), ...);
+  }
+
+  /**
+   * Returns the pool of a bean type, if getBeanPool created one.
+   *
+   * \param type compile-time type identifier of the pooled beans.
+   * \return the pool, or nullptr if there is none yet.
+   */
+  virtual BeanPoolBase *findBeanPool(const BeanType &type) = 0;
+
+  /**
+   * Takes ownership of the pool of a bean type, unless another thread added one first.
+   *
+   * Pools live as long as the factory and must be destroyed before the beans are.
+   *
+   * \param type compile-time type identifier of the pooled beans.
+   * \param pool the new pool.
+   * \return the pool of the type: pool, or the one added before.
+   */
+  virtual BeanPoolBase &addBeanPool(const BeanType &type, std::unique_ptr<BeanPoolBase> pool) = 0;
+
+  /**
+   * Instances of the thread scope of the calling thread, for this factory.
+   *
+   * Must not lock once the calling thread has its scope. The instances are destroyed when the thread
+   * exits, or with the factory if it goes away first.
+   */
+  virtual ScopedBeans &threadScopedBeans() = 0;
+
+  /**
+   * Instances of the innermost RequestScope opened on the calling thread for this factory.
+   *
+   * \return the scope, or nullptr if there is no such RequestScope.
+   */
+  ScopedBeans *requestScopedBeans() const noexcept;
+
   /**
    * Produces a default bean name for the given type.
    * Implementations may override customized naming strategies.
    *
    * \param type compile-time type identifier of the bean.
-   * \return a default, implementation-defined, stable bean name for this type.
+   * \return a default, implementation-defined, stable bean name for this type. The view only has
+   *         to stay valid until it is passed to registerBean.
+   */
+  virtual std::string_view makeDefaultBeanName(const BeanType &type);
+
+  /**
+   * Memory resource used to allocate the beans built by createSingleton and the lazy beans.
+   *
+   * The default implementation uses the process-wide default resource. Implementations can return
+   * an arena so that beans are packed together and released at once when the factory goes away.
+   *
+   * \return the resource beans are allocated from; must outlive every bean allocated from it.
    */
-  virtual std::string makeDefaultBeanName(const BeanType &type);
+  virtual std::pmr::memory_resource *beanMemoryResource() { return std::pmr::get_default_resource(); }
 
   /**
-   * Creates a type-erased deleter for T that integrates with the factory's deletion pipeline.
+   * Memory resource used to allocate the instances built by getNewInstance.
    *
-   * The deleter will first notify the factory via deleteBean(ptr) and then invoke the allocator-aware
-   * destroy() for T on the provided memory address.
+   * Prototypes come and go for the whole life of the factory, so unlike beanMemoryResource() this
+   * must hand the memory of a destroyed instance back for reuse: no arena. The default
+   * implementation uses the process-wide default resource.
    *
-   * \tparam Tp Bean type.
-   * \return a callable suitable to be stored alongside the bean in the registry.
+   * \return the resource prototypes are allocated from; must outlive every instance allocated from
+   *         it and be usable from several threads once the factory is shared.
+   */
+  virtual std::pmr::memory_resource *prototypeMemoryResource() { return std::pmr::get_default_resource(); }
+
+  /// Longest constructor autowiring looks for
+  static constexpr std::size_t MAX_AUTOWIRED_ARGS = 8;
+
+  /// Thrown by Autowired when no bean can be bound to a reference parameter, before the constructor runs
+  struct MissingAutowiredBean {};
+
+  /**
+   * Constructor argument standing for "the first bean of whatever type this parameter wants".
+   *
+   * Converts to any pointer or lvalue reference but those to Tp itself, so the copy and move
+   * constructors of Tp are never picked. The parameter type is deduced at compile time, so
+   * resolving it is a getFirstBeanTyped: an index into the per-type buckets, no registry scan.
    */
   template<typename Tp>
-  deleter_t makeDeleter() {
-    return [this](void *ptr) {
-      auto allocDeleter = std::allocator<Tp>();
-      deleteBean(ptr);
-      std::allocator_traits<decltype(allocDeleter)>::destroy(allocDeleter, static_cast<Tp *>(ptr));
-    };
+  struct Autowired {
+    BeanFactory *factory;
+
+    template<typename U, std::enable_if_t<!std::is_same_v<std::remove_cv_t<U>, Tp>, int> = 0>
+    operator U *() const {
+      return factory->getFirstBeanTyped<U>();
+    }
+
+    template<typename U, std::enable_if_t<!std::is_pointer_v<U> && !std::is_same_v<std::remove_cv_t<U>, Tp>, int> = 0>
+    operator U &() const {
+      // Arguments are converted before the constructor is entered, throwing here backs out of the
+      // call without building anything
+      const auto bean = factory->getFirstBeanTyped<U>();
+      if (bean == nullptr) {
+        throw MissingAutowiredBean{};
+      }
+      return *bean;
+    }
+  };
+
+  template<typename Tp, std::size_t>
+  using AutowiredArg = Autowired<Tp>;
+
+  template<typename Tp, std::size_t... Is>
+  static constexpr bool isAutowirable(std::index_sequence<Is...>) {
+    return std::is_constructible_v<Tp, AutowiredArg<Tp, Is>...>;
+  }
+
+  /// Number of parameters of the shortest constructor of Tp taking only beans, 0 if there is none
+  template<typename Tp, std::size_t N = 1>
+  static constexpr std::size_t autowiredArity() {
+    if constexpr (N > MAX_AUTOWIRED_ARGS) {
+      return 0;
+    } else if constexpr (isAutowirable<Tp>(std::make_index_sequence<N>{})) {
+      return N;
+    } else {
+      return autowiredArity<Tp, N + 1>();
+    }
+  }
+
+  template<typename Tp, std::size_t... Is>
+  void constructAutowired(std::pmr::polymorphic_allocator<Tp> &alloc, Tp *ptr, std::index_sequence<Is...>) {
+    std::allocator_traits<std::pmr::polymorphic_allocator<Tp>>::construct(alloc, ptr, AutowiredArg<Tp, Is>{this}...);
+  }
+
+  /**
+   * Constructs a bean in its storage, autowiring its constructor when no argument is given and it
+   * is not default constructible. If the constructor throws, the storage is deallocated and the
+   * exception rethrown; nothing was registered yet, so nothing else needs undoing.
+   *
+   * \return true if the bean was built; false, with the storage deallocated, when a reference
+   *         parameter has no bean to bind to.
+   */
+  template<typename Tp, typename... Args>
+  bool constructBean(std::pmr::polymorphic_allocator<Tp> &alloc, Tp *ptr, Args &&...args) {
+    try {
+      if constexpr (sizeof...(Args) == 0 && !std::is_default_constructible_v<Tp>) {
+        static_assert(autowiredArity<Tp>() != 0, "bean type is neither default constructible nor autowirable");
+        constructAutowired(alloc, ptr, std::make_index_sequence<autowiredArity<Tp>()>{});
+      } else {
+        std::allocator_traits<std::pmr::polymorphic_allocator<Tp>>::construct(alloc, ptr, std::forward<Args>(args)...);
+      }
+      return true;
+    } catch (const MissingAutowiredBean &) {
+      std::allocator_traits<std::pmr::polymorphic_allocator<Tp>>::deallocate(alloc, ptr, 1);
+      return false;
+    } catch (...) {
+      std::allocator_traits<std::pmr::polymorphic_allocator<Tp>>::deallocate(alloc, ptr, 1);
+      throw;
+    }
   }
 
   /**
    * Wires framework-aware dependencies into a freshly constructed/registered bean.
    *
+   * - If Tp declares BeanInterfaces, indexes the bean under each of them.
    * - If Tp derives from ApplicationContextAware, notifies the factory to inject the context.
    * - If Tp derives from BeanFactoryAware, injects a reference to this factory.
    *
@@ -121,6 +591,12 @@ protected:
    */
   template<typename Tp>
   void handleBeanDependencies(Tp *bean) {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    using Interfaces = typename BeanInterfaces<TpNoCV>::type;
+    if constexpr (std::tuple_size_v<Interfaces> != 0) {
+      registerBeanInterfaces(const_cast<TpNoCV *>(bean), static_cast<Interfaces *>(nullptr));
+    }
+
     if constexpr (std::is_base_of_v<ApplicationContextAware, Tp>) {
       applicationContextAwareCreated(bean);
     }
@@ -134,6 +610,36 @@ protected:
     }
   }
 
+  /**
+   * Allocates and registers the storage of a lazily built bean.
+   *
+   * \return true if the definition was registered; false on failure (e.g., name conflict).
+   */
+  template<typename Tp, typename Factory>
+  bool allocateLazyBean(std::string_view beanName, std::unique_ptr<LazyBeanOf<Tp, Factory>> lazy) {
+    auto type = BeanType::type_id<Tp>();
+    auto resource = beanMemoryResource();
+    auto alloc = std::pmr::polymorphic_allocator<Tp>(resource);
+
+    // Allocate memory, the bean is constructed in it later
+    if (auto ptr = std::allocator_traits<decltype(alloc)>::allocate(alloc, 1)) {
+      if (!registerLazyBean(type, ptr, BeanOps::allocated<Tp>(), resource,
+                            beanName.empty() ? makeDefaultBeanName(type) : beanName, std::move(lazy))) {
+        std::allocator_traits<decltype(alloc)>::deallocate(alloc, ptr, 1);
+        return false;
+      }
+
+      // Looking the bean up by interface builds it too
+      using Interfaces = typename BeanInterfaces<Tp>::type;
+      if constexpr (std::tuple_size_v<Interfaces> != 0) {
+        registerBeanInterfaces(ptr, static_cast<Interfaces *>(nullptr));
+      }
+      return true;
+    }
+
+    return false;
+  }
+
 public:
   using BeanNameT = std::string_view;
 
@@ -143,9 +649,17 @@ public:
   /**
    * Creates and registers a singleton bean managed by the factory.
    *
-   * Memory is allocated using std::allocator for Tp (with cv-qualifiers removed) and then the object
-   * is constructed in-place. If registration fails (e.g., name conflict), the memory is deallocated
-   * and nullptr is returned.
+   * Memory is allocated from beanMemoryResource() for Tp (with cv-qualifiers removed), the object is
+   * constructed in-place and only then registered, so concurrent lookups never see it half built. If
+   * registration fails (e.g., name conflict), the bean is destroyed, the memory deallocated and
+   * nullptr is returned. An exception thrown by the constructor propagates once the memory is
+   * deallocated, leaving the factory unchanged.
+   *
+   * Called without arguments on a type that is not default constructible, the constructor is
+   * autowired: the shortest constructor whose parameters are all pointers or lvalue references is
+   * used, each parameter receiving the first bean of its type. Missing beans are passed as nullptr
+   * to pointer parameters; a missing bean for a reference parameter makes it return nullptr without
+   * calling the constructor.
    *
    * \tparam Tp   Concrete bean type to create (must not be an array type).
    * \tparam Args Constructor argument types.
@@ -156,19 +670,23 @@ public:
   Tp *createSingleton(Args &&...args) {
     using TpNoCV = std::remove_cv_t<Tp>;
     auto type = BeanType::type_id<TpNoCV>();
-    auto alloc = std::allocator<TpNoCV>();
+    auto resource = beanMemoryResource();
+    auto alloc = std::pmr::polymorphic_allocator<TpNoCV>(resource);
 
     // Allocate memory
     if (auto ptr = std::allocator_traits<decltype(alloc)>::allocate(alloc, 1)) {
+      // Construct this bean before registering it, lookups never see a bean under construction
+      if (!constructBean(alloc, ptr, std::forward<Args>(args)...)) {
+        return nullptr;
+      }
+
       // Register this bean
-      if (!registerBean(type, ptr, makeDeleter<Tp>(), type.name())) {
+      if (!registerBean(type, ptr, BeanOps::allocated<TpNoCV>(), resource, type.name())) {
+        std::allocator_traits<decltype(alloc)>::destroy(alloc, ptr);
         std::allocator_traits<decltype(alloc)>::deallocate(alloc, ptr, 1);
         return nullptr;
       }
 
-      // Construct this bean
-      std::allocator_traits<decltype(alloc)>::construct(alloc, ptr, std::forward<Args>(args)...);
-
       // Handle the interfaces that make this bean aware of its env
       handleBeanDependencies(ptr);
       return ptr;
@@ -177,23 +695,78 @@ public:
     return nullptr;
   }
 
+  /**
+   * Defines a singleton bean that is only built the first time it is looked up.
+   *
+   * Memory is allocated from beanMemoryResource() and registered under the given name right away,
+   * but factory is only invoked, and the framework-aware dependencies injected, when getBeanTyped,
+   * getFirstBeanTyped or getBeansTyped first hand out the bean. Concurrent first lookups build it
+   * once. A bean that was never looked up is never constructed nor destroyed.
+   *
+   * \tparam Tp      Concrete bean type to define.
+   * \param beanName unique bean name; if empty, a default name is generated for Tp.
+   * \param factory  callable returning a Tp, invoked with a BeanFactory & if it accepts one.
+   * \return true if the definition was registered; false on failure (e.g., name conflict).
+   */
+  template<typename Tp, typename Factory, std::enable_if_t<!std::is_array_v<Tp>, int> = 0>
+  bool defineLazyBean(std::string_view beanName, Factory &&factory) {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    return allocateLazyBean(beanName, std::make_unique<LazyBeanOf<TpNoCV, std::decay_t<Factory>>>(std::forward<Factory>(factory)));
+  }
+
+  /**
+   * Defines a singleton bean built when the context initializes, once its dependencies are built.
+   *
+   * Works like defineLazyBean, except that ApplicationContext::initialize() builds every bean
+   * defined this way, running independent ones concurrently. A lookup before that builds the bean
+   * right away, as for a lazy bean. Dependencies that are not defined through defineBean are not
+   * waited for; they are built on demand when the factory looks them up.
+   *
+   * \tparam Tp       Concrete bean type to define.
+   * \param beanName  unique bean name; if empty, a default name is generated for Tp.
+   * \param dependsOn names of the beans the factory looks up.
+   * \param factory   callable returning a Tp, invoked with a BeanFactory & if it accepts one.
+   * \return true if the definition was registered; false on failure (e.g., name conflict).
+   */
+  template<typename Tp, typename Factory, std::enable_if_t<!std::is_array_v<Tp>, int> = 0>
+  bool defineBean(std::string_view beanName, std::vector<std::string> dependsOn, Factory &&factory) {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    auto lazy = std::make_unique<LazyBeanOf<TpNoCV, std::decay_t<Factory>>>(std::forward<Factory>(factory));
+    lazy->setEager(std::move(dependsOn));
+    return allocateLazyBean(beanName, std::move(lazy));
+  }
+
+  /**
+   * Creates and registers a new, default constructed, bean under a generated name.
+   *
+   * Memory is allocated from prototypeMemoryResource(), so destroying the instance makes its memory
+   * available to the next one. The constructor is autowired the same way as for createSingleton
+   * when Tp is not default constructible.
+   *
+   * \tparam Tp Concrete bean type to create.
+   * \return pointer to the created bean on success; nullptr on failure.
+   */
   template<typename Tp>
   Tp *getNewInstance() {
     using TpNoCV = std::remove_cv_t<Tp>;
     auto type = BeanType::type_id<TpNoCV>();
-    auto alloc = std::allocator<TpNoCV>();
+    auto resource = prototypeMemoryResource();
+    auto alloc = std::pmr::polymorphic_allocator<TpNoCV>(resource);
 
     // Allocate memory
     if (auto ptr = std::allocator_traits<decltype(alloc)>::allocate(alloc, 1)) {
+      // Construct this bean before registering it, lookups never see a bean under construction
+      if (!constructBean(alloc, ptr)) {
+        return nullptr;
+      }
+
       // Register this bean
-      if (!registerBean(type, ptr, makeDeleter<Tp>(), makeDefaultBeanName(type))) {
+      if (!registerBean(type, ptr, BeanOps::allocated<TpNoCV>(), resource, makeDefaultBeanName(type))) {
+        std::allocator_traits<decltype(alloc)>::destroy(alloc, ptr);
         std::allocator_traits<decltype(alloc)>::deallocate(alloc, ptr, 1);
         return nullptr;
       }
 
-      // Construct this bean
-      std::allocator_traits<decltype(alloc)>::construct(alloc, ptr);
-
       // Handle the interfaces that make this bean aware of its env
       handleBeanDependencies(ptr);
       return ptr;
@@ -202,6 +775,71 @@ public:
     return nullptr;
   }
 
+  /**
+   * Returns the pool of recycled Tp instances of this factory, creating it on first use.
+   *
+   * Requires including sproutpp/bean_pool.h. Keep the reference around on hot paths, it stays
+   * valid as long as the factory.
+   *
+   * \tparam Tp     Pooled bean type, default constructible and implementing ResettableBean.
+   * \param maxIdle maximum number of idle instances kept per thread; only used when the pool is created.
+   * \return the pool of Tp.
+   */
+  template<typename Tp>
+  BeanPool<std::remove_cv_t<Tp>> &getBeanPool(std::size_t maxIdle = 64) {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    auto type = BeanType::type_id<TpNoCV>();
+
+    if (const auto pool = findBeanPool(type)) {
+      return static_cast<BeanPool<TpNoCV> &>(*pool);
+    }
+    return static_cast<BeanPool<TpNoCV> &>(addBeanPool(type, std::make_unique<BeanPool<TpNoCV>>(*this, maxIdle)));
+  }
+
+  /**
+   * Hands out a prototype instance from the pool of Tp, building it only if no idle one is left.
+   *
+   * Unlike getNewInstance, nothing is registered with the factory: the instance is reset and
+   * recycled when the returned handle is dropped, which must happen before the factory goes away.
+   *
+   * \tparam Tp Pooled bean type, default constructible and implementing ResettableBean.
+   * \return an owning handle on the instance.
+   */
+  template<typename Tp>
+  auto getPooledInstance() {
+    return getBeanPool<Tp>().acquire();
+  }
+
+  /**
+   * Returns the instance of Tp belonging to the current thread or request, building it on first use.
+   *
+   * Scoped instances are default constructed in the scope's own arena and wired like any other bean,
+   * but are not registered with the factory: each scope sees its own instance and no lookup locks.
+   * They are destroyed in bulk, newest first, when their scope ends.
+   *
+   * \tparam Tp   Scoped bean type, default constructible.
+   * \param scope BeanScope::THREAD for the calling thread, BeanScope::REQUEST for the innermost
+   *              RequestScope opened on this factory by the calling thread (see sproutpp/request_scope.h).
+   * \return the scoped instance, or nullptr for BeanScope::REQUEST outside of any RequestScope.
+   */
+  template<typename Tp>
+  Tp *getScopedBean(BeanScope scope) {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    const auto type = BeanType::type_id<TpNoCV>().id();
+    const auto beans = scope == BeanScope::THREAD ? &threadScopedBeans() : requestScopedBeans();
+
+    if (beans == nullptr) {
+      return nullptr;
+    }
+    if (const auto bean = beans->find(type)) {
+      return static_cast<Tp *>(bean);
+    }
+
+    const auto bean = beans->create<TpNoCV>(type);
+    handleBeanDependencies(bean);
+    return bean;
+  }
+
   /**
    * Registers an already constructed bean instance with the factory.
    *
@@ -221,7 +859,7 @@ public:
 
     if (auto bean = ptr.release()) {
       // Register this bean with the factory
-      if (!registerBean(type, bean, makeDeleter<Tp>(), (beanName.empty() ? makeDefaultBeanName(type) : std::string(beanName)))) {
+      if (!registerBean(type, bean, BeanOps::owned<Tp>(), nullptr, (beanName.empty() ? makeDefaultBeanName(type) : beanName))) {
         std::abort();
       }
       handleBeanDependencies<Tp>(bean);
@@ -264,6 +902,9 @@ public:
   /**
    * Retrieves the first bean matching the requested type.
    *
+   * Beans registered with exactly that type come first, then the beans declaring Tp among their
+   * BeanInterfaces, as an already adjusted Tp pointer.
+   *
    * \tparam Tp Expected bean type.
    * \return pointer to the first matching bean or nullptr if none exist.
    */
@@ -272,6 +913,24 @@ public:
     using TpNoCV = std::remove_cv_t<Tp>;
     return static_cast<Tp *>(getFirstBeanOfType(BeanType::type_id<TpNoCV>()));
   }
+
+  /**
+   * Retrieves all the beans matching the requested type.
+   *
+   * \tparam Tp Expected bean type.
+   * \return the matching beans in registration order, the ones declaring Tp among their
+   *         BeanInterfaces last; empty if none exist.
+   */
+  template<typename Tp>
+  std::vector<Tp *> getBeansTyped() {
+    using TpNoCV = std::remove_cv_t<Tp>;
+    const auto beans = getBeansOfType(BeanType::type_id<TpNoCV>());
+
+    std::vector<Tp *> result;
+    result.reserve(beans.size());
+    std::ranges::transform(beans, std::back_inserter(result), [](void *bean) { return static_cast<Tp *>(bean); });
+    return result;
+  }
 };
 
 }// namespace framework
@@ -0,0 +1,144 @@
+
+#pragma once
+
+#include "bean_factory.h"
+#include "resettable_bean.h"
+
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+namespace framework {
+
+/**
+ * Pool of recycled instances of a prototype bean type, obtained through BeanFactory::getBeanPool.
+ *
+ * acquire() hands out an idle instance when there is one and only builds a new one otherwise.
+ * Instances go back to the pool when their handle is dropped: they are reset through
+ * ResettableBean::resetBean() then kept on a free list for the next acquire(), or destroyed if that
+ * list is full. Nothing is registered with the factory, pooled instances have no name.
+ *
+ * Free lists are per thread (threads beyond BeanPoolBase::THREAD_SLOTS share them), so a thread
+ * mostly takes its own lock, uncontended; it only looks at the other lists when its own is empty.
+ *
+ * Instances are allocated from a synchronized pool resource owned by the pool, not from the bean
+ * memory resource of the factory, which may not be thread-safe: acquire() and recycle() run on any
+ * thread whatever the mode of the factory. The memory of destroyed instances is reused by the next
+ * ones and released with the pool.
+ *
+ * The factory owns the pool and destroys the idle instances with it. Every handle must be dropped
+ * before the factory goes away.
+ *
+ * \tparam Tp Pooled bean type, default constructible and implementing ResettableBean.
+ */
+template<typename Tp>
+class BeanPool final : public BeanPoolBase {
+  static_assert(std::is_base_of_v<ResettableBean, Tp>, "pooled beans must implement ResettableBean");
+
+  struct alignas(64) FreeList {
+    std::mutex mutex;
+    std::vector<Tp *> beans;
+  };
+
+  BeanFactory &_factory;
+  std::size_t _max_idle;
+  std::pmr::synchronized_pool_resource _resource;
+  std::array<FreeList, THREAD_SLOTS> _free;
+
+  Tp *create() {
+    auto alloc = std::pmr::polymorphic_allocator<Tp>(&_resource);
+    const auto bean = std::allocator_traits<decltype(alloc)>::allocate(alloc, 1);
+    try {
+      std::allocator_traits<decltype(alloc)>::construct(alloc, bean);
+    } catch (...) {
+      std::allocator_traits<decltype(alloc)>::deallocate(alloc, bean, 1);
+      throw;
+    }
+
+    // Wired once, recycled instances keep their dependencies
+    _factory.handleBeanDependencies(bean);
+    return bean;
+  }
+
+  void destroy(Tp *bean) {
+    auto alloc = std::pmr::polymorphic_allocator<Tp>(&_resource);
+    std::allocator_traits<decltype(alloc)>::destroy(alloc, bean);
+    std::allocator_traits<decltype(alloc)>::deallocate(alloc, bean, 1);
+  }
+
+public:
+  /// Returns an instance to its pool
+  struct Recycler {
+    BeanPool *pool;
+    void operator()(Tp *bean) const { pool->recycle(bean); }
+  };
+
+  /// Owning handle on a pooled instance, recycles it when dropped
+  using Handle = std::unique_ptr<Tp, Recycler>;
+
+  /**
+   * \param factory the factory beans are wired with.
+   * \param maxIdle maximum number of idle instances kept per free list.
+   */
+  BeanPool(BeanFactory &factory, std::size_t maxIdle)
+      : _factory(factory), _max_idle(maxIdle), _resource(std::pmr::get_default_resource()) {}
+
+  ~BeanPool() override {
+    for (auto &freeList: _free) {
+      for (const auto bean: freeList.beans) {
+        destroy(bean);
+      }
+    }
+  }
+
+  /**
+   * \return an idle instance if there is one, otherwise a new one.
+   */
+  Handle acquire() {
+    const auto slot = threadSlot();
+    {
+      auto &own = _free[slot];
+      const std::lock_guard lock(own.mutex);
+      if (!own.beans.empty()) {
+        const auto bean = own.beans.back();
+        own.beans.pop_back();
+        return Handle(bean, Recycler{this});
+      }
+    }
+
+    // Instances may have been returned on other threads
+    for (std::size_t i = 1; i < THREAD_SLOTS; i++) {
+      auto &other = _free[(slot + i) % THREAD_SLOTS];
+      const std::unique_lock lock(other.mutex, std::try_to_lock);
+      if (lock && !other.beans.empty()) {
+        const auto bean = other.beans.back();
+        other.beans.pop_back();
+        return Handle(bean, Recycler{this});
+      }
+    }
+
+    return Handle(create(), Recycler{this});
+  }
+
+  /**
+   * Resets an instance and keeps it for a later acquire(), or destroys it when the free list of
+   * this thread is full. Called by the handle.
+   */
+  void recycle(Tp *bean) {
+    bean->resetBean();
+    {
+      auto &own = _free[threadSlot()];
+      const std::lock_guard lock(own.mutex);
+      if (own.beans.size() < _max_idle) {
+        own.beans.push_back(bean);
+        return;
+      }
+    }
+    destroy(bean);
+  }
+};
+
+}// namespace framework
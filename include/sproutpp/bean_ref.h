@@ -0,0 +1,57 @@
+
+#pragma once
+
+#include "bean_factory.h"
+
+namespace framework {
+
+/**
+ * Cached handle on the first bean of a type.
+ *
+ * BeanRef resolves getFirstBeanTyped<Tp>() once and keeps the answer along with the factory's
+ * generation counter for Tp. Subsequent calls to get() only load the counter and compare it,
+ * re-resolving through the factory when a registration or deletion changed the first bean of Tp.
+ *
+ * The factory must outlive the handle. On a child context, the handle follows the beans of the
+ * parents as well.
+ *
+ * \tparam Tp Expected bean type.
+ */
+template<typename Tp>
+class BeanRef {
+  using TpNoCV = std::remove_cv_t<Tp>;
+
+  BeanFactory *_factory;
+  const std::atomic<std::uint64_t> *_generation;
+  mutable std::uint64_t _seen = 0;
+  mutable Tp *_bean = nullptr;
+
+  void refresh() const {
+    // Read the generation first so a concurrent change is picked up by the next get()
+    _seen = _generation->load(std::memory_order_acquire);
+    _bean = _factory->template getFirstBeanTyped<Tp>();
+  }
+
+public:
+  explicit BeanRef(BeanFactory &factory)
+      : _factory(&factory),
+        _generation(&factory.firstBeanGeneration(BeanFactory::BeanType::type_id<TpNoCV>())) {
+    refresh();
+  }
+
+  /**
+   * \return the first bean of type Tp, or nullptr if none is registered.
+   */
+  Tp *get() const {
+    if (_generation->load(std::memory_order_acquire) != _seen) [[unlikely]] {
+      refresh();
+    }
+    return _bean;
+  }
+
+  Tp *operator->() const { return get(); }
+  Tp &operator*() const { return *get(); }
+  explicit operator bool() const { return get() != nullptr; }
+};
+
+}// namespace framework
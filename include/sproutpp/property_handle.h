@@ -0,0 +1,112 @@
+#pragma once
+
+#include "property_source.h"
+
+#include <atomic>
+#include <charconv>
+#include <memory>
+#include <string>
+#include <type_traits>
+
+namespace framework {
+
+/**
+ * Class PropertyHandleBase
+ *
+ * What a PropertyResolver keeps of a handle: the resolver calls update() with the new value of the
+ * property whenever it may have changed.
+ */
+class PropertyHandleBase {
+public:
+  virtual ~PropertyHandleBase() = default;
+
+  /**
+   * \brief Converts the value the property now resolves to and publishes it.
+   *
+   * \param value the resolved value, std::monostate when the property is absent.
+   */
+  virtual void update(const PropertySource::Value &value) = 0;
+
+  /// Whether other converts the property the same way, so either can be handed out for it
+  virtual bool sameBinding(const PropertyHandleBase &other) const = 0;
+
+  /// A new handle converting the property the same way, for the resolver to keep
+  virtual std::unique_ptr<PropertyHandleBase> clone() const = 0;
+};
+
+/**
+ * \brief Typed view of a single property, obtained through PropertyResolver::getPropertyHandle.
+ *
+ * The value is converted once, when the handle is created and each time the resolver sees the
+ * property change, and kept in an atomic: get() is a single load, with no string nor lookup
+ * involved. Strings are parsed with std::from_chars; "true" and "false" are accepted for bool.
+ * An absent or unparsable value yields the default value.
+ *
+ * Handles are owned by their resolver and stay valid as long as it.
+ *
+ * \tparam T an arithmetic type (bool, integer or floating point).
+ */
+template<typename T>
+class PropertyHandle final : public PropertyHandleBase {
+  static_assert(std::is_arithmetic_v<T>, "property handles hold arithmetic values");
+
+  std::atomic<T> _value;
+  const T _default;
+
+  T convert(const PropertySource::Value &value) const {
+    if (const auto str = std::get_if<std::string>(&value)) {
+      if constexpr (std::is_same_v<T, bool>) {
+        if (*str == "true" || *str == "1") {
+          return true;
+        }
+        if (*str == "false" || *str == "0") {
+          return false;
+        }
+        return _default;
+      } else {
+        T result{};
+        const auto [end, ec] = std::from_chars(str->data(), str->data() + str->size(), result);
+        return ec == std::errc() && end == str->data() + str->size() ? result : _default;
+      }
+    }
+
+    if (const auto number = std::get_if<int>(&value)) {
+      return static_cast<T>(*number);
+    }
+
+    if (const auto number = std::get_if<double>(&value)) {
+      return static_cast<T>(*number);
+    }
+
+    if (const auto flag = std::get_if<bool>(&value)) {
+      return static_cast<T>(*flag);
+    }
+
+    return _default;
+  }
+
+public:
+  explicit PropertyHandle(T defaultValue) : _value(defaultValue), _default(defaultValue) {}
+
+  /**
+   * \return the current value of the property.
+   */
+  T get() const { return _value.load(std::memory_order_acquire); }
+
+  T operator*() const { return get(); }
+
+  void update(const PropertySource::Value &value) override {
+    _value.store(convert(value), std::memory_order_release);
+  }
+
+  bool sameBinding(const PropertyHandleBase &other) const override {
+    const auto handle = dynamic_cast<const PropertyHandle *>(&other);
+    return handle != nullptr && handle->_default == _default;
+  }
+
+  std::unique_ptr<PropertyHandleBase> clone() const override {
+    return std::make_unique<PropertyHandle>(_default);
+  }
+};
+
+}// namespace framework
@@ -1,8 +1,18 @@
 
 #pragma once
 
+#include "property_handle.h"
 #include "property_source.h"
+#include "property_view.h"
+#include "typed_value.h"
+#include <algorithm>
+#include <charconv>
 #include <functional>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <utility>
 
 namespace framework {
 
@@ -21,6 +31,32 @@ namespace framework {
  * their concurrency guarantees if required by the application.
  */
 class PropertyResolver {
+  /// Parses like std::stoi: leading whitespace and '+' are skipped, trailing characters ignored
+  static int parseInt(std::string_view str) {
+    str.remove_prefix(std::min(str.find_first_not_of(" \t\n\v\f\r"), str.size()));
+    if (str.size() > 1 && str.front() == '+' && str[1] != '-') {
+      str.remove_prefix(1);
+    }
+
+    int result{};
+    const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+    if (ec == std::errc::invalid_argument) {
+      throw std::invalid_argument("stoi");
+    }
+    if (ec == std::errc::result_out_of_range) {
+      throw std::out_of_range("stoi");
+    }
+    return result;
+  }
+
+public:
+  /**
+   * \brief Callback receiving a batch of changed property names.
+   *
+   * Each name appears once per batch. An empty batch means that any property may have changed,
+   * as happens when a source is registered.
+   */
+  using PropertiesChangedCallback = std::function<void(std::span<const std::string> propertyNames)>;
 
 protected:
   /**
@@ -41,6 +77,27 @@ protected:
    */
   virtual void registerPropertySourceFactory(std::string_view sourceName, PropertySourceFactory factory) = 0;
 
+  /**
+   * \brief Find the handle of a property converting it like binding, or else keep a clone of
+   * binding, update it with the current value of the property and keep it updated whenever the
+   * property may have changed.
+   *
+   * \param propertyName The property key the handle follows.
+   * \param binding      How the handle converts the property; not kept.
+   * \return The handle kept by the resolver.
+   */
+  virtual PropertyHandleBase &addPropertyHandle(std::string_view propertyName, const PropertyHandleBase &binding) = 0;
+
+  /**
+   * \brief Register a watcher for a property name, or for every name starting with a prefix.
+   *
+   * \param key      The property name, or the prefix.
+   * \param prefix   Whether key is a prefix.
+   * \param callback Called with the matching names of each batch of changes.
+   * \return An identifier for removePropertyWatcher.
+   */
+  virtual std::size_t addPropertyWatcher(std::string_view key, bool prefix, PropertiesChangedCallback callback) = 0;
+
 public:
   virtual ~PropertyResolver() = default;
 
@@ -79,6 +136,28 @@ public:
    */
   virtual PropertySource::Value getProperty(std::string_view propertyName) = 0;
 
+  /**
+   * \brief Retrieve a property value by name without copying it.
+   *
+   * The string of the view is owned by the resolver, and kept alive by the view: it stays valid
+   * as long as the view, even if another thread changes the property meanwhile. No string is
+   * copied nor allocated.
+   *
+   * \param propertyName The property key to look up.
+   * \return A view of the value (std::monostate if the property is not present).
+   */
+  virtual PropertyView getPropertyView(std::string_view propertyName) = 0;
+
+  /**
+   * \brief Retrieve a property parsed into every type it can be read as, see TypedValue.
+   *
+   * The value is parsed once, when the resolver resolves it, and not again until it changes.
+   *
+   * \param propertyName The property key to look up.
+   * \return The parsed value; every member holds PropertyError::MISSING if the property is not present.
+   */
+  virtual TypedValue getTypedProperty(std::string_view propertyName) = 0;
+
   /**
    * \brief Check whether a property exists.
    *
@@ -86,7 +165,7 @@ public:
    * \return true if a non-monostate value is resolved; false otherwise.
    */
   virtual bool containsProperty(std::string_view propertyName) {
-    return !std::holds_alternative<std::monostate>(getProperty(propertyName));
+    return !std::holds_alternative<std::monostate>(getPropertyView(propertyName).value());
   }
 
   /**
@@ -100,9 +179,10 @@ public:
    * \return The string representation or defaultValue.
    */
   virtual std::string getPropertyAsString(std::string_view propertyName, std::string defaultValue = "") {
-    const auto value = getProperty(propertyName);
-    if (std::holds_alternative<std::string>(value)) {
-      return std::get<std::string>(value);
+    const auto view = getPropertyView(propertyName);
+    const auto &value = view.value();
+    if (std::holds_alternative<std::string_view>(value)) {
+      return std::string(std::get<std::string_view>(value));
     }
 
     if (std::holds_alternative<int>(value)) {
@@ -124,7 +204,8 @@ public:
    *
    * This method attempts to fetch the property identified by the specified name and convert it to an integer
    * if possible. Supported conversions include:
-   * - Strings: Parsed into integers using `std::stoi`.
+   * - Strings: Parsed into integers like `std::stoi` does, throwing the same exceptions. Strings holding
+   *   an integer as a whole are read from the value parsed by getTypedProperty.
    * - Integers: Returned as-is.
    * - Doubles: Cast to integers.
    * - Booleans: Converted to 1 for true, and 0 for false.
@@ -137,9 +218,19 @@ public:
    * \return The resolved integer value, or defaultValue if the property is absent or unconvertible.
    */
   virtual int getPropertyAsInt(std::string_view propertyName, int defaultValue = {}) {
-    const auto value = getProperty(propertyName);
-    if (std::holds_alternative<std::string>(value)) {
-      return std::stoi(std::get<std::string>(value));
+    // Parsed already in the common case
+    const auto typed = getTypedProperty(propertyName).integer;
+    if (typed && std::in_range<int>(*typed)) {
+      return static_cast<int>(*typed);
+    }
+    if (!typed && typed.error() == PropertyError::MISSING) {
+      return defaultValue;
+    }
+
+    const auto view = getPropertyView(propertyName);
+    const auto &value = view.value();
+    if (std::holds_alternative<std::string_view>(value)) {
+      return parseInt(std::get<std::string_view>(value));
     }
 
     if (std::holds_alternative<int>(value)) {
@@ -157,6 +248,97 @@ public:
     return defaultValue;
   }
 
+  /**
+   * \brief Retrieve a property as a 64-bit integer, without throwing nor parsing.
+   *
+   * \param propertyName The property key to look up.
+   * \return The value, or why there is none.
+   */
+  PropertyResult<std::int64_t> getPropertyAsInt64(std::string_view propertyName) {
+    return getTypedProperty(propertyName).integer;
+  }
+
+  /**
+   * \brief Retrieve a property as a floating point number, see getPropertyAsInt64.
+   */
+  PropertyResult<double> getPropertyAsDouble(std::string_view propertyName) {
+    return getTypedProperty(propertyName).floating;
+  }
+
+  /**
+   * \brief Retrieve a property as a boolean, see getPropertyAsInt64.
+   */
+  PropertyResult<bool> getPropertyAsBool(std::string_view propertyName) {
+    return getTypedProperty(propertyName).boolean;
+  }
+
+  /**
+   * \brief Retrieve a property as a duration such as "30s", see getPropertyAsInt64.
+   */
+  PropertyResult<std::chrono::nanoseconds> getPropertyAsDuration(std::string_view propertyName) {
+    return getTypedProperty(propertyName).duration;
+  }
+
+  /**
+   * \brief Retrieve a property as a size in bytes such as "64KB", see getPropertyAsInt64.
+   */
+  PropertyResult<std::uint64_t> getPropertyAsByteSize(std::string_view propertyName) {
+    return getTypedProperty(propertyName).byteSize;
+  }
+
+  /**
+   * \brief Bind a property once and read its typed value through the returned handle.
+   *
+   * Meant for hot paths: PropertyHandle::get() is a single atomic load, the key is only resolved
+   * and the value only converted again when the property changes. Binding the same property with
+   * the same type and default value again returns the same handle, nothing is allocated.
+   *
+   * \tparam T           An arithmetic type (bool, integer or floating point).
+   * \param propertyName The property key to follow.
+   * \param defaultValue The value used while the property is missing or cannot be converted.
+   * \return A handle owned by this resolver and valid as long as it.
+   */
+  template<typename T>
+  PropertyHandle<T> &getPropertyHandle(std::string_view propertyName, T defaultValue = {}) {
+    const PropertyHandle<T> binding(defaultValue);
+    return static_cast<PropertyHandle<T> &>(addPropertyHandle(propertyName, binding));
+  }
+
+  /**
+   * \brief Watch a single property.
+   *
+   * Changes are coalesced into batches and delivered on a dispatcher thread, never on the thread
+   * that made the change: a burst of updates wakes each watcher once, and only the watchers of
+   * the names that changed. A callback must not destroy the resolver it watches: the dispatcher
+   * thread would be destroyed from itself, which aborts the process.
+   *
+   * \param propertyName The property to watch.
+   * \param callback     Called with the name each time the property changed.
+   * \return An identifier for removePropertyWatcher.
+   */
+  std::size_t watchProperty(std::string_view propertyName, PropertiesChangedCallback callback) {
+    return addPropertyWatcher(propertyName, false, std::move(callback));
+  }
+
+  /**
+   * \brief Watch every property whose name starts with a prefix, see watchProperty.
+   *
+   * \param prefix   The prefix, "db." for instance.
+   * \param callback Called with the matching names of each batch of changes.
+   * \return An identifier for removePropertyWatcher.
+   */
+  std::size_t watchProperties(std::string_view prefix, PropertiesChangedCallback callback) {
+    return addPropertyWatcher(prefix, true, std::move(callback));
+  }
+
+  /**
+   * \brief Stop a watcher. Once this returns the callback is not running and will not be called
+   * again, unless this is called from the callback itself.
+   *
+   * \param watcher The identifier returned by watchProperty or watchProperties.
+   */
+  virtual void removePropertyWatcher(std::size_t watcher) = 0;
+
   /**
    * \brief Retrieve a property value or abort the process if missing.
    *
@@ -46,6 +46,15 @@ protected:
     }
   }
 
+  /**
+   * \brief Notify all registered watchers that any property may have changed.
+   *
+   * For sources that cannot tell which names a change affects, e.g. because a
+   * property can be looked up under several spellings. Watchers receive an
+   * empty name.
+   */
+  void notifyAllValuesChanged() const { notifyValueChanged({}); }
+
 public:
   /**
    * \brief Variant type representing a property value.
@@ -55,10 +64,29 @@ public:
    */
   using Value = std::variant<std::string, int, double, bool, std::monostate>;
 
+  /**
+   * \brief Value borrowing its string from storage owned by someone else.
+   *
+   * Same alternatives, in the same order, as Value; see PropertyResolver::getPropertyView for how
+   * long the string stays valid.
+   */
+  using ValueView = std::variant<std::string_view, int, double, bool, std::monostate>;
+
+  /**
+   * \brief Borrow a view of a value.
+   *
+   * \param value The value to view, must outlive the view.
+   * \return The view, its string pointing into value.
+   */
+  static ValueView view(const Value &value) {
+    return std::visit([](const auto &alternative) -> ValueView { return alternative; }, value);
+  }
+
   /**
    * \brief Callback type invoked when a property's value changes.
    *
-   * The single argument is the name of the property that changed.
+   * The single argument is the name of the property that changed, or an empty
+   * name when any property may have changed (see notifyAllValuesChanged).
    */
   using PropertyChangedCallback = std::function<void(std::string_view propertyName)>;
 
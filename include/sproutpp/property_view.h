@@ -0,0 +1,41 @@
+#pragma once
+
+#include "property_source.h"
+
+#include <memory>
+#include <utility>
+#include <variant>
+
+namespace framework {
+
+/**
+ * \brief A property value borrowed from its resolver, obtained through PropertyResolver::getPropertyView.
+ *
+ * The view shares ownership of the resolved value it points into: its string stays valid as long
+ * as the view, whatever changes the properties go through meanwhile, on any thread. A property
+ * changed since shows in the next lookup, the view keeps the value it was created with.
+ *
+ * Copying a view shares that value again, the string is never copied.
+ */
+class PropertyView {
+  PropertySource::ValueView _value = std::monostate();
+  std::shared_ptr<const void> _owner;
+
+public:
+  /// A view of an absent property
+  PropertyView() = default;
+
+  /**
+   * \param value The view of the value.
+   * \param owner Keeps the storage value points into alive, empty if value borrows nothing.
+   */
+  PropertyView(PropertySource::ValueView value, std::shared_ptr<const void> owner)
+      : _value(value), _owner(std::move(owner)) {}
+
+  /// The value, std::monostate when the property is absent
+  const PropertySource::ValueView &value() const noexcept { return _value; }
+  const PropertySource::ValueView &operator*() const noexcept { return _value; }
+  const PropertySource::ValueView *operator->() const noexcept { return &_value; }
+};
+
+}// namespace framework
@@ -0,0 +1,41 @@
+
+#pragma once
+
+#include "bean_factory.h"
+
+namespace framework {
+
+/**
+ * Class RequestScope
+ *
+ * Opens a request scope on a factory for the calling thread: while it is alive,
+ * BeanFactory::getScopedBean(BeanScope::REQUEST) hands out instances that belong to it, and they
+ * are all destroyed when it ends. Scopes nest; the innermost one opened on a factory wins.
+ *
+ * A RequestScope belongs to the thread that opened it and must be destroyed on that thread, in the
+ * reverse order of creation. The factory must outlive it.
+ */
+class RequestScope {
+  const BeanFactory &_factory;
+  RequestScope *_previous;
+  ScopedBeans _beans;
+
+  /// Innermost scope opened on the calling thread, whatever its factory
+  static RequestScope *&current() noexcept;
+
+  friend class BeanFactory;
+
+public:
+  explicit RequestScope(const BeanFactory &factory) : _factory(factory), _previous(current()) { current() = this; }
+
+  ~RequestScope() {
+    // Still current, so the instances can use each other while being destroyed
+    _beans.clear();
+    current() = _previous;
+  }
+
+  RequestScope(const RequestScope &) = delete;
+  RequestScope &operator=(const RequestScope &) = delete;
+};
+
+}// namespace framework
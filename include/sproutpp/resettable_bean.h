@@ -0,0 +1,19 @@
+
+#pragma once
+
+namespace framework {
+
+/**
+ * Class ResettableBean
+ *
+ * Implemented by beans handed out from a BeanPool: resetBean() is called when an instance goes
+ * back to the pool and must bring it back to the state of a freshly constructed one.
+ */
+class ResettableBean {
+
+public:
+  virtual ~ResettableBean() = default;
+  virtual void resetBean() = 0;
+};
+
+}// namespace framework
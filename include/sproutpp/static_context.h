@@ -0,0 +1,185 @@
+
+#pragma once
+
+#include "bean_factory.h"
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace framework {
+
+/**
+ * Bean container whose bean set is fixed at compile time.
+ *
+ * Every bean lives inline in the context, in the order of the type list: no heap allocation, no
+ * type erasure, and get<Tp>() is a member access at an offset known at compile time. Beans are
+ * built in list order and destroyed in reverse order. A bean that is not default constructible is
+ * autowired with the beans listed before it: the shortest constructor whose parameters are all
+ * pointers or lvalue references to such beans is used.
+ *
+ * exposeTo() registers the beans with a regular BeanFactory (e.g. an ApplicationContext) without
+ * handing over their ownership, for code that looks beans up through the dynamic interface.
+ *
+ * \tparam Beans Bean types, distinct, in construction order.
+ */
+template<typename... Beans>
+class StaticContext {
+  static_assert(((std::is_object_v<Beans> && !std::is_const_v<Beans> && !std::is_volatile_v<Beans>) && ...),
+                "beans must be cv-unqualified object types");
+
+  static constexpr std::size_t SIZE = sizeof...(Beans);
+  static constexpr std::size_t MAX_AUTOWIRED_ARGS = 8;
+
+  /// Position of Tp in the type list, SIZE if it is not listed
+  template<typename Tp>
+  static constexpr std::size_t indexOf() {
+    constexpr bool matches[] = {std::is_same_v<Tp, Beans>..., false};
+    for (std::size_t i = 0; i < SIZE; i++) {
+      if (matches[i]) {
+        return i;
+      }
+    }
+    return SIZE;
+  }
+
+  template<typename Tp>
+  static constexpr std::size_t countOf() {
+    return (std::size_t{std::is_same_v<Tp, Beans>} + ... + 0);
+  }
+
+  template<std::size_t I>
+  using BeanAt = std::tuple_element_t<I, std::tuple<Beans...>>;
+
+  template<typename Bean>
+  struct Slot {
+    alignas(Bean) std::byte storage[sizeof(Bean)];
+  };
+
+  std::tuple<Slot<Beans>...> _slots;
+  /// Number of beans built, they are the first ones of the list
+  std::size_t _constructed = 0;
+
+  /// Constructor argument resolving to any bean listed before Self
+  template<typename Self>
+  struct Autowired {
+    StaticContext *context;
+
+    template<typename U, std::enable_if_t<(indexOf<std::remove_cv_t<U>>() < indexOf<Self>()), int> = 0>
+    operator U *() const {
+      return &context->template get<std::remove_cv_t<U>>();
+    }
+
+    template<typename U, std::enable_if_t<!std::is_pointer_v<U> && (indexOf<std::remove_cv_t<U>>() < indexOf<Self>()), int> = 0>
+    operator U &() const {
+      return context->template get<std::remove_cv_t<U>>();
+    }
+  };
+
+  template<typename Self, std::size_t>
+  using AutowiredArg = Autowired<Self>;
+
+  template<typename Bean, std::size_t... Is>
+  static constexpr bool isAutowirable(std::index_sequence<Is...>) {
+    return std::is_constructible_v<Bean, AutowiredArg<Bean, Is>...>;
+  }
+
+  template<typename Bean, std::size_t N = 1>
+  static constexpr std::size_t autowiredArity() {
+    if constexpr (N > MAX_AUTOWIRED_ARGS) {
+      return 0;
+    } else if constexpr (isAutowirable<Bean>(std::make_index_sequence<N>{})) {
+      return N;
+    } else {
+      return autowiredArity<Bean, N + 1>();
+    }
+  }
+
+  template<typename Bean, std::size_t... Is>
+  void constructAutowired(void *storage, std::index_sequence<Is...>) {
+    ::new (storage) Bean(AutowiredArg<Bean, Is>{this}...);
+  }
+
+  template<std::size_t I>
+  void constructAt() {
+    using Bean = BeanAt<I>;
+    void *storage = std::get<I>(_slots).storage;
+
+    if constexpr (std::is_default_constructible_v<Bean>) {
+      ::new (storage) Bean();
+    } else {
+      static_assert(autowiredArity<Bean>() != 0, "bean type is neither default constructible nor autowirable from the beans before it");
+      constructAutowired<Bean>(storage, std::make_index_sequence<autowiredArity<Bean>()>{});
+    }
+    _constructed++;
+  }
+
+  template<std::size_t... Is>
+  void constructAll(std::index_sequence<Is...>) {
+    (constructAt<Is>(), ...);
+  }
+
+  template<std::size_t... Is>
+  void destroyAll(std::index_sequence<Is...>) noexcept {
+    // Newest first, skipping the ones a throwing constructor left unbuilt
+    ((SIZE - 1 - Is < _constructed ? std::destroy_at(&get<BeanAt<SIZE - 1 - Is>>()) : void()), ...);
+    _constructed = 0;
+  }
+
+  template<typename Bean>
+  void exposeBean(BeanFactory &factory) {
+    const auto type = BeanFactory::BeanType::type_id<Bean>();
+    auto &bean = get<Bean>();
+
+    if (!factory.registerBean(type, &bean, BeanFactory::BeanOps::unowned(), nullptr, factory.makeDefaultBeanName(type))) {
+      std::abort();
+    }
+    factory.handleBeanDependencies(&bean);
+  }
+
+public:
+  StaticContext() {
+    static_assert(((countOf<Beans>() == 1) && ...), "bean types must be distinct");
+
+    try {
+      constructAll(std::index_sequence_for<Beans...>{});
+    } catch (...) {
+      destroyAll(std::index_sequence_for<Beans...>{});
+      throw;
+    }
+  }
+
+  ~StaticContext() { destroyAll(std::index_sequence_for<Beans...>{}); }
+
+  StaticContext(const StaticContext &) = delete;
+  StaticContext &operator=(const StaticContext &) = delete;
+
+  /**
+   * \tparam Tp one of the bean types of this context.
+   * \return the bean of type Tp.
+   */
+  template<typename Tp>
+  Tp &get() noexcept {
+    static_assert(indexOf<std::remove_cv_t<Tp>>() != SIZE, "not a bean of this context");
+    return *std::launder(reinterpret_cast<std::remove_cv_t<Tp> *>(std::get<indexOf<std::remove_cv_t<Tp>>()>(_slots).storage));
+  }
+
+  template<typename Tp>
+  const Tp &get() const noexcept {
+    return const_cast<StaticContext *>(this)->template get<Tp>();
+  }
+
+  /**
+   * Registers every bean with a factory, in list order and under default names, then wires their
+   * framework-aware interfaces. The factory never destroys them and must go away before this
+   * context does. Aborts if a name is already taken, like BeanFactory::registerExistingBean.
+   */
+  void exposeTo(BeanFactory &factory) {
+    (exposeBean<Beans>(factory), ...);
+  }
+};
+
+}// namespace framework
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <expected>
+
+namespace framework {
+
+/**
+ * \brief Why a typed property getter returned no value.
+ */
+enum class PropertyError {
+  /// The property is not present
+  MISSING,
+  /// The value cannot be read as the requested type
+  INVALID,
+  /// The value is of the requested type but does not fit in it
+  OUT_OF_RANGE,
+};
+
+/**
+ * \brief Outcome of a typed property getter.
+ */
+template<typename T>
+using PropertyResult = std::expected<T, PropertyError>;
+
+/**
+ * \brief A property value parsed once into every type it can be read as.
+ *
+ * Strings are parsed with std::from_chars and must be matched as a whole:
+ * - integer: a decimal 64-bit integer, an optional '+' sign allowed.
+ * - floating: a decimal or scientific floating point number.
+ * - boolean: "true", "false", "1" or "0".
+ * - duration: an integer followed by one of the units ns, us, ms, s, m, h or d; milliseconds
+ *   when there is none: "250ms", "30s", "500".
+ * - byteSize: a non-negative integer followed by one of the units B, KB, MB, GB or TB, in powers
+ *   of 1024; bytes when there is none: "64KB", "4096".
+ *
+ * Values stored as int, double or bool convert to the types they represent exactly; an int is a
+ * duration in milliseconds and, when non-negative, a size in bytes.
+ */
+struct TypedValue {
+  PropertyResult<std::int64_t> integer{std::unexpect, PropertyError::MISSING};
+  PropertyResult<double> floating{std::unexpect, PropertyError::MISSING};
+  PropertyResult<bool> boolean{std::unexpect, PropertyError::MISSING};
+  PropertyResult<std::chrono::nanoseconds> duration{std::unexpect, PropertyError::MISSING};
+  PropertyResult<std::uint64_t> byteSize{std::unexpect, PropertyError::MISSING};
+};
+
+}// namespace framework
@@ -1,10 +1,37 @@
 
 #include "sproutpp/bean_factory.h"
+#include "sproutpp/request_scope.h"
+
+#include <atomic>
 
 namespace framework {
-std::string BeanFactory::makeDefaultBeanName(const BeanType &type) {
-  auto name = std::string(type.name());
-  return name;
+std::size_t BeanFactory::nextBeanTypeId() noexcept {
+  static std::atomic<std::size_t> nextId{0};
+  return nextId.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::size_t BeanPoolBase::threadSlot() noexcept {
+  static std::atomic<std::size_t> nextSlot{0};
+  thread_local const std::size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed) % THREAD_SLOTS;
+  return slot;
+}
+
+RequestScope *&RequestScope::current() noexcept {
+  thread_local RequestScope *scope = nullptr;
+  return scope;
+}
+
+ScopedBeans *BeanFactory::requestScopedBeans() const noexcept {
+  for (auto scope = RequestScope::current(); scope != nullptr; scope = scope->_previous) {
+    if (&scope->_factory == this) {
+      return &scope->_beans;
+    }
+  }
+  return nullptr;
+}
+
+std::string_view BeanFactory::makeDefaultBeanName(const BeanType &type) {
+  return type.name();
 }
 
 }// namespace framework
@@ -1,7 +1,12 @@
 
 #include "compositing_property_resolver.h"
 
+#include <algorithm>
+#include <list>
 #include <ranges>
+#include <vector>
+
+#include "property_sources/flat_property_source.h"
 
 namespace {
 std::string extractImportConfig(const framework::PropertySource &source) {
@@ -18,7 +23,164 @@ std::string extractImportConfig(const framework::PropertySource &source) {
 
 namespace framework::impl {
 
+CompositingPropertyResolver::~CompositingPropertyResolver() {
+  // Watchers and dependents read the cache, they must be gone before it is
+  unfollowResolver();
+  stopWatchers();
+  delete _snapshot.load(std::memory_order_acquire);
+}
+
+void CompositingPropertyResolver::enableConcurrentPropertyAccess() {
+  const std::lock_guard lock(_resolved_mutex);
+  if (_concurrent.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // Lookups only switch to the snapshot once there is one
+  _epoch = std::make_unique<EpochDomain>();
+  publishSnapshot();
+  _concurrent.store(true, std::memory_order_release);
+}
+
+void CompositingPropertyResolver::publishSnapshot() {
+  if (!_epoch) {
+    return;
+  }
+
+  auto next = std::make_unique<ResolvedSnapshot>();
+  next->values.reserve(_resolved.size());
+  for (const auto &[propertyName, property]: _resolved) {
+    next->values.emplace(propertyName, property);
+  }
+
+  // Lookups that may still read the previous snapshot are done once synchronize returns
+  const auto previous = _snapshot.exchange(next.release(), std::memory_order_acq_rel);
+  _epoch->synchronize();
+  delete previous;
+}
+
 void CompositingPropertyResolver::valueChanged(std::string_view propertyName) {
+  // The property, then every value expanded from it
+  std::vector<std::string> changed{std::string(propertyName)};
+  // Freed once no lookup can read them anymore
+  std::vector<std::shared_ptr<const ResolvedProperty>> previous;
+  {
+    const std::lock_guard lock(_resolved_mutex);
+    dropTemplate(propertyName);
+    for (std::size_t i = 0; i < changed.size(); i++) {
+      if (const auto it = _referenced_by.find(changed[i]); it != _referenced_by.end()) {
+        for (const auto &referrer: it->second) {
+          if (std::ranges::find(changed, referrer) == changed.end()) {
+            changed.push_back(referrer);
+          }
+        }
+      }
+    }
+
+    for (const auto &name: changed) {
+      if (const auto it = _resolved.find(name); it != _resolved.end()) {
+        previous.push_back(std::move(it->second));
+        _resolved.erase(it);
+      }
+    }
+    if (!previous.empty()) {
+      publishSnapshot();
+    }
+  }
+  _generation.fetch_add(1, std::memory_order_release);
+
+  {
+    const std::lock_guard lock(_handles_mutex);
+    for (const auto &name: changed) {
+      if (const auto it = _handles.find(name); it != _handles.end()) {
+        const auto value = getProperty(name);
+        for (const auto &handle: it->second) {
+          handle->update(value);
+        }
+      }
+    }
+  }
+  for (const auto &name: changed) {
+    _dispatcher->propertyChanged(this, name);
+  }
+
+  const std::lock_guard lock(_dependents_mutex);
+  for (const auto dependent: _dependents) {
+    for (const auto &name: changed) {
+      dependent->valueChanged(name);
+    }
+  }
+}
+
+void CompositingPropertyResolver::sourcesChanged() {
+  ResolvedMap previous;
+  {
+    const std::lock_guard lock(_resolved_mutex);
+    previous.swap(_resolved);
+    _templates.clear();
+    _referenced_by.clear();
+    publishSnapshot();
+  }
+  _generation.fetch_add(1, std::memory_order_release);
+
+  {
+    const std::lock_guard lock(_handles_mutex);
+    for (const auto &[propertyName, handles]: _handles) {
+      const auto value = getProperty(propertyName);
+      for (const auto &handle: handles) {
+        handle->update(value);
+      }
+    }
+  }
+  _dispatcher->allPropertiesChanged(this);
+
+  const std::lock_guard lock(_dependents_mutex);
+  for (const auto dependent: _dependents) {
+    dependent->sourcesChanged();
+  }
+}
+
+PropertyHandleBase &CompositingPropertyResolver::addPropertyHandle(std::string_view propertyName, const PropertyHandleBase &binding) {
+  subscribeToFollowed();
+
+  const std::lock_guard lock(_handles_mutex);
+  auto it = _handles.find(propertyName);
+  if (it == _handles.end()) {
+    it = _handles.try_emplace(std::string(propertyName)).first;
+  } else if (const auto found = std::ranges::find_if(it->second, [&binding](const auto &handle) { return handle->sameBinding(binding); });
+             found != it->second.end()) {
+    return **found;
+  }
+
+  // Updated under the lock, so a change cannot slip in between
+  auto handle = binding.clone();
+  handle->update(getProperty(propertyName));
+  return *it->second.emplace_back(std::move(handle));
+}
+
+std::size_t CompositingPropertyResolver::addPropertyWatcher(std::string_view key, bool prefix, PropertiesChangedCallback callback) {
+  subscribeToFollowed();
+  return _dispatcher->addWatcher(this, key, prefix, std::move(callback));
+}
+
+void CompositingPropertyResolver::subscribeToFollowed() {
+  if (_followed != nullptr) {
+    std::call_once(_follow_once, [this] {
+      // The followed resolver only hears of its own parent's changes if it relays them too
+      _followed->subscribeToFollowed();
+
+      const std::lock_guard lock(_followed->_dependents_mutex);
+      _followed->_dependents.insert(this);
+    });
+  }
+}
+
+void CompositingPropertyResolver::unfollowResolver() {
+  if (_followed != nullptr) {
+    const std::lock_guard lock(_followed->_dependents_mutex);
+    _followed->_dependents.erase(this);
+    _followed = nullptr;
+  }
 }
 
 void CompositingPropertyResolver::registerPropertySourceFactory(std::string_view sourceName, PropertySourceFactory factory) {
@@ -31,7 +193,12 @@ void CompositingPropertyResolver::handleDynamicSourceNotifications(PropertySourc
     // Make sure we get notified of values changes so we can broadcast it
     source.clearValueWatchers();
     source.addValueWatcher([this](std::string_view propertyName) {
-      valueChanged(propertyName);
+      // An empty name stands for any property, whatever name it was looked up with
+      if (propertyName.empty()) {
+        sourcesChanged();
+      } else {
+        valueChanged(propertyName);
+      }
     });
   }
 }
@@ -62,12 +229,129 @@ void CompositingPropertyResolver::registerPropertySource(std::unique_ptr<Propert
   while (source) {
     const auto postImport = extractImportConfig(*source);
     handleDynamicSourceNotifications(*source);
-    _sources.emplace_back(std::move(source));
+    {
+      const std::lock_guard lock(_resolved_mutex);
+      _sources.emplace_back(std::move(source));
+    }
     source = loadPropertySourceFromImportString(postImport);
   }
+
+  // The new sources may shadow any cached value, or resolve a cached miss
+  sourcesChanged();
+}
+
+void CompositingPropertyResolver::flattenStaticSources() {
+  const std::lock_guard lock(_resolved_mutex);
+  std::list<std::unique_ptr<PropertySource>> sources;
+  std::vector<std::unique_ptr<PropertySource>> run;
+
+  const auto endRun = [&sources, &run] {
+    if (run.size() == 1) {
+      sources.emplace_back(std::move(run.front()));
+    } else if (!run.empty()) {
+      auto flat = std::make_unique<FlatPropertySource>();
+      for (const auto &layer: run) {
+        flat->addLayer(static_cast<const MapPropertySource &>(*layer));
+      }
+      sources.emplace_back(std::move(flat));
+    }
+    run.clear();
+  };
+
+  for (auto &source: _sources) {
+    if (source->isStatic() && dynamic_cast<const MapPropertySource *>(source.get()) != nullptr) {
+      run.emplace_back(std::move(source));
+      continue;
+    }
+
+    endRun();
+    sources.emplace_back(std::move(source));
+  }
+  endRun();
+
+  // Every name resolves as before, the cached values stay valid
+  _sources = std::move(sources);
+}
+
+const std::shared_ptr<const CompositingPropertyResolver::ResolvedProperty> &
+CompositingPropertyResolver::cachedProperty(std::string_view propertyName) {
+  if (const auto it = _resolved.find(propertyName); it != _resolved.end()) {
+    return it->second;
+  }
+
+  auto value = interpolate(propertyName);
+  auto typed = parseTypedValue(value);
+  auto property = std::make_shared<const ResolvedProperty>(std::string(propertyName), std::move(value), typed);
+  const auto &result = _resolved.emplace(property->name, std::move(property)).first->second;
+  publishSnapshot();
+  return result;
+}
+
+PropertySource::Value CompositingPropertyResolver::interpolate(std::string_view propertyName) {
+  auto it = _templates.find(propertyName);
+  if (it == _templates.end()) {
+    auto value = resolve(propertyName);
+    const auto str = std::get_if<std::string>(&value);
+    auto compiled = str != nullptr ? PropertyTemplate::compile(*str) : nullptr;
+    if (!compiled) {
+      return value;
+    }
+
+    for (const auto &key: compiled->references()) {
+      _referenced_by[key].emplace(propertyName);
+    }
+    it = _templates.emplace(propertyName, std::move(compiled)).first;
+  }
+
+  // Templates compiled while expanding may rehash the map: the key stays valid, the iterator does not
+  const auto compiled = it->second;
+  _expanding.push_back(it->first);
+  // Values of the followed resolver, kept until the expansion is done
+  std::list<PropertySource::Value> followed;
+  auto expanded = compiled->expand([this, &followed](std::string_view key) -> const PropertySource::Value * {
+    if (std::ranges::find(_expanding, key) != _expanding.end()) {
+      return nullptr;
+    }
+    const auto &value = cachedProperty(key)->value;
+    if (_followed == nullptr || !std::holds_alternative<std::monostate>(value)) {
+      return &value;
+    }
+    return &followed.emplace_back(_followed->getProperty(key));
+  });
+  _expanding.pop_back();
+  return expanded;
+}
+
+void CompositingPropertyResolver::dropTemplate(std::string_view propertyName) {
+  const auto it = _templates.find(propertyName);
+  if (it == _templates.end()) {
+    return;
+  }
+
+  for (const auto &key: it->second->references()) {
+    if (const auto referrers = _referenced_by.find(key); referrers != _referenced_by.end()) {
+      referrers->second.erase(it->first);
+      if (referrers->second.empty()) {
+        _referenced_by.erase(referrers);
+      }
+    }
+  }
+  _templates.erase(it);
 }
 
 PropertySource::Value CompositingPropertyResolver::getProperty(std::string_view propertyName) {
+  return readProperty(propertyName, [](const auto &property) { return property->value; });
+}
+
+PropertyView CompositingPropertyResolver::getPropertyView(std::string_view propertyName) {
+  return readProperty(propertyName, [](const auto &property) { return PropertyView(PropertySource::view(property->value), property); });
+}
+
+TypedValue CompositingPropertyResolver::getTypedProperty(std::string_view propertyName) {
+  return readProperty(propertyName, [](const auto &property) { return property->typed; });
+}
+
+PropertySource::Value CompositingPropertyResolver::resolve(std::string_view propertyName) const {
   // Search LIFO
   for (const auto &source: std::ranges::reverse_view(_sources)) {
     if (const auto value = source->getProperty(propertyName);
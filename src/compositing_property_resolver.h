@@ -1,35 +1,213 @@
 
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <list>
 #include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
 #include <system_error>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
+#include "epoch_domain.h"
+#include "property_change_dispatcher.h"
+#include "property_template.h"
 #include "sproutpp/property_resolver.h"
+#include "string_hash.h"
+#include "typed_value_parser.h"
 
 namespace framework::impl {
 
 /**
    * Class CompositingPropertyResolver
+   *
+   * Resolved values are cached by property name, misses included; the views handed out by
+   * getPropertyView point into that cache and share ownership of the value. A dynamic source reporting a
+   * change drops that name from the cache, registering a source drops the whole cache. Values
+   * of dynamic sources that change without calling notifyValueChanged are not seen once cached.
+   *
+   * Lookups are serialized by a mutex unless enableConcurrentPropertyAccess() was called: from then
+   * on they read an immutable snapshot of the cache under an EpochDomain pin and never block, only
+   * misses and changes take the mutex and publish a new snapshot.
+   *
+   * Each value is parsed into a TypedValue when it is cached, typed getters read that and never parse.
+   *
+   * String values holding ${key} or ${key:default} placeholders are compiled once into a
+   * PropertyTemplate, and cached expanded. Placeholders are resolved through this resolver's own
+   * sources, then through the followed resolver if any. Each key's referrers are tracked: a change to a key drops it and, transitively, the
+   * values expanded from it, which are expanded again from their compiled template on next lookup.
+   *
+   * Property handles are updated on the same events, on the thread that reported the change;
+   * watchers are notified of them in batches, on the thread of a PropertyChangeDispatcher. A resolver following another one (see
+   * followResolver) also relays the changes of the followed resolver to its own handles, and shares
+   * its dispatcher: a whole tree of resolvers notifies its watchers from a single thread.
    */
 class CompositingPropertyResolver : public virtual PropertyResolver {
-  std::map<std::string, PropertySource::Value, std::less<>> _staticSources;
+  /// A resolved value, allocated on its own so snapshots and views can share it
+  struct ResolvedProperty {
+    std::string name;
+    PropertySource::Value value;
+    /// value parsed once, when resolved
+    TypedValue typed;
+  };
+
+  /// Immutable copy of the cache, read by lookups in concurrent mode
+  struct ResolvedSnapshot {
+    std::unordered_map<std::string_view, std::shared_ptr<const ResolvedProperty>, StringHash, std::equal_to<>> values;
+  };
+
+  using ResolvedMap = std::unordered_map<std::string_view, std::shared_ptr<const ResolvedProperty>, StringHash, std::equal_to<>>;
+
   std::list<std::unique_ptr<PropertySource>> _sources;
   std::map<size_t, PropertySourceFactory> _property_source_factory;
+  /// Bumped whenever a lookup may resolve differently than before
+  std::atomic<std::uint64_t> _generation{0};
+  /// Serializes the changes to _sources and _resolved, and the lookups outside concurrent mode
+  std::mutex _resolved_mutex;
+  /// What each property name resolved to, std::monostate for misses
+  ResolvedMap _resolved;
+  /// Whether lookups go through the published snapshot
+  std::atomic<bool> _concurrent{false};
+  /// Last published snapshot, only set in concurrent mode
+  std::atomic<const ResolvedSnapshot *> _snapshot{nullptr};
+  /// Tracks the lookups still reading a snapshot, only created in concurrent mode
+  std::unique_ptr<EpochDomain> _epoch;
+
+  using NameSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+  /// Compiled values of the properties holding placeholders, kept until their raw value changes
+  std::unordered_map<std::string, std::shared_ptr<const PropertyTemplate>, StringHash, std::equal_to<>> _templates;
+  /// Properties whose template refers to each key
+  std::unordered_map<std::string, NameSet, StringHash, std::equal_to<>> _referenced_by;
+  /// Templates being expanded, a reference back to one of them stays unresolved
+  std::vector<std::string_view> _expanding;
+
+  /// Guards _handles
+  std::mutex _handles_mutex;
+  /// Handles by the property name they follow
+  std::unordered_map<std::string, std::vector<std::unique_ptr<PropertyHandleBase>>, StringHash, std::equal_to<>> _handles;
+
+  /// Resolver this one falls back to, if any
+  CompositingPropertyResolver *_followed = nullptr;
+  /// Registers with _followed once this resolver has handles to update
+  std::once_flag _follow_once;
+  /// Guards _dependents
+  std::mutex _dependents_mutex;
+  /// Resolvers following this one and having handles, watchers or dependents of their own
+  std::unordered_set<CompositingPropertyResolver *> _dependents;
 
+  /// Delivers the changes to the watchers, shared with the followed resolver if any
+  std::shared_ptr<PropertyChangeDispatcher> _dispatcher = std::make_shared<PropertyChangeDispatcher>();
+
+  PropertySource::Value resolve(std::string_view propertyName) const;
+  /// Resolves a property and expands its placeholders; _resolved_mutex must be held
+  PropertySource::Value interpolate(std::string_view propertyName);
+  /// Forgets the template of a property, if any; _resolved_mutex must be held
+  void dropTemplate(std::string_view propertyName);
+  /// Cached property, resolved first if needed; _resolved_mutex must be held
+  const std::shared_ptr<const ResolvedProperty> &cachedProperty(std::string_view propertyName);
+  /// Publishes a fresh snapshot when in concurrent mode; _resolved_mutex must be held
+  void publishSnapshot();
+
+  /**
+   * Hands the cached property to read, without locking when in concurrent mode.
+   *
+   * read runs while the property is guarded, by the mutex or an epoch pin, and its result is
+   * returned once it is not anymore: it must copy what it needs out of the property, or share it
+   * as getPropertyView does.
+   */
+  template<typename Read>
+  auto readProperty(std::string_view propertyName, Read &&read) {
+    static_assert(!std::is_reference_v<std::invoke_result_t<Read, const std::shared_ptr<const ResolvedProperty> &>>,
+                  "the property is only guarded while read runs");
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      const auto &values = _snapshot.load(std::memory_order_acquire)->values;
+      if (const auto it = values.find(propertyName); it != values.end()) {
+        return read(it->second);
+      }
+    }
+
+    // Resolving may expand placeholders through the followed resolver, which must relay its changes
+    subscribeToFollowed();
+    const std::lock_guard lock(_resolved_mutex);
+    return read(cachedProperty(propertyName));
+  }
   void valueChanged(std::string_view propertyName);
+  /// Drops every cached value and updates every handle, after the sources changed
+  void sourcesChanged();
+  /// Starts relaying the changes of _followed, and makes it relay the ones of its own followed
+  void subscribeToFollowed();
   void handleDynamicSourceNotifications(PropertySource &source);
   std::unique_ptr<PropertySource> loadPropertySourceFromImportString(std::string_view postImport);
 
 protected:
   void registerPropertySourceFactory(std::string_view sourceName, PropertySourceFactory factory) override;
+  PropertyHandleBase &addPropertyHandle(std::string_view propertyName, const PropertyHandleBase &binding) override;
+  std::size_t addPropertyWatcher(std::string_view key, bool prefix, PropertiesChangedCallback callback) override;
+
+  /**
+   * Relays the changes of another resolver, which this one falls back to in getProperty, to the
+   * handles and watchers of this one, and notifies the watchers on its dispatcher. Must be called
+   * before any of them is added.
+   */
+  void followResolver(CompositingPropertyResolver &followed) {
+    _followed = &followed;
+    _dispatcher = followed._dispatcher;
+  }
+
+  /**
+   * Stops relaying the changes of the followed resolver, must be called before the state
+   * getProperty relies on is destroyed.
+   */
+  void unfollowResolver();
+
+  /**
+   * Stops notifying the watchers of this resolver, dropping the changes still pending for them and
+   * waiting for the callbacks running. Must be called before the state the watchers rely on is
+   * destroyed.
+   */
+  void stopWatchers() { _dispatcher->removeWatchers(this); }
 
 public:
-  ~CompositingPropertyResolver() override = default;
+  ~CompositingPropertyResolver() override;
 
   void registerPropertySource(std::unique_ptr<PropertySource> &&source) override;
   PropertySource::Value getProperty(std::string_view propertyName) override;
+  PropertyView getPropertyView(std::string_view propertyName) override;
+  TypedValue getTypedProperty(std::string_view propertyName) override;
+  void removePropertyWatcher(std::size_t watcher) override { _dispatcher->removeWatcher(watcher); }
+
+  /**
+   * Waits until the watchers were notified of every change reported so far. Must not be called
+   * from a watcher.
+   */
+  void flushPropertyChanges() { _dispatcher->flush(); }
+
+  /**
+   * Merges each run of consecutive static sources into a single FlatPropertySource, keeping the
+   * precedence of every value. Only sources built on MapPropertySource can be merged, the others
+   * are kept as they are.
+   */
+  void flattenStaticSources();
+
+  /**
+   * Switches to concurrent mode: from now on lookups may run on any thread while sources change,
+   * and never block unless the property is not cached yet. Each miss and each change then costs
+   * a copy of the cache, so concurrent access is best enabled once the sources are registered.
+   * Cannot be undone.
+   */
+  void enableConcurrentPropertyAccess();
+
+  /**
+   * Changes when a source is registered or a dynamic source reports a change, so values resolved
+   * earlier can be cached and checked with a single load.
+   */
+  virtual std::uint64_t propertyGeneration() const { return _generation.load(std::memory_order_acquire); }
 };
 
 }// namespace framework::impl
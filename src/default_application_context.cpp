@@ -1,7 +1,12 @@
 
 #include "default_application_context.h"
 
+#include <fmt/chrono.h>
 #include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <algorithm>
+#include <iterator>
+#include <thread>
 
 #include "property_sources/environment_property_source.h"
 #include "property_sources/property_file_property_source.h"
@@ -17,27 +22,203 @@ namespace framework::impl {
 DefaultApplicationContext::DefaultApplicationContext(std::string name)
     : _my_logger(std::make_shared<spdlog::logger>(name, make_default_sink())),
       _name(std::move(name)) {
+  setBeanMemoryResource(&_bean_arena);
+  setPrototypeMemoryResource(&_prototype_pool);
   spdlog::initialize_logger(_my_logger);
   _my_logger->info("Creating application context {}", _name);
 }
 
+DefaultApplicationContext::DefaultApplicationContext(DefaultApplicationContext &parent, std::string name)
+    : _parent(&parent),
+      _parent_owner(parent.weak_from_this().lock()),
+      _my_logger(parent._my_logger),
+      _name(std::move(name)),
+      _enabledProfiles(parent._enabledProfiles) {
+  setBeanMemoryResource(&_bean_arena);
+  setPrototypeMemoryResource(&_prototype_pool);
+  followResolver(parent);
+  _my_logger->debug("Creating child context {} of {}", _name, parent._name);
+}
+
 DefaultApplicationContext::~DefaultApplicationContext() {
-  _my_logger->info("Destroying application context {}", _name);
+  // The parent must stop updating our handles, and the watchers stop running, before the parent
+  // lookup cache goes away
+  unfollowResolver();
+  stopWatchers();
+
+  if (_parent != nullptr) {
+    _my_logger->debug("Destroying child context {}", _name);
+  } else {
+    _my_logger->info("Destroying application context {}", _name);
+  }
+
+  // Beans may still use the context while being destroyed, and the arena goes away with it
+  destroyBeans();
+  _bean_arena.release();
 }
 
 void DefaultApplicationContext::initialize() {
-  // Load application.properties and for each active profile load application-<profile>.properties
-  registerPropertySource(std::make_unique<PropertyFilePropertySource>("application.properties"));
+  // Children get the files and the environment through their parent
+  if (_parent == nullptr) {
+    // Load application.properties and for each active profile load application-<profile>.properties
+    registerPropertySource(std::make_unique<PropertyFilePropertySource>("application.properties"));
+
+    for (const auto &activeProfile: activeProfiles()) {
+      registerPropertySource(std::make_unique<PropertyFilePropertySource>(fmt::format("application-{}.properties", activeProfile)));
+    }
 
-  for (const auto &activeProfile: activeProfiles()) {
-    registerPropertySource(std::make_unique<PropertyFilePropertySource>(fmt::format("application-{}.properties", activeProfile)));
+    // Load ENV also, copied once if the files ask for it
+    if (const auto snapshot = getPropertyAsString("properties.env.snapshot"); snapshot == "true" || snapshot == "1") {
+      registerPropertySource(std::make_unique<EnvironmentPropertySource>(EnvironmentPropertySource::Mode::SNAPSHOT,
+                                                                         getPropertyAsString("properties.env.prefix")));
+    } else {
+      registerPropertySource(std::make_unique<EnvironmentPropertySource>());
+    }
+
+    // The files and their imports never change, look them up in a single table
+    flattenStaticSources();
   }
 
-  // Load ENV also
-  registerPropertySource(std::make_unique<EnvironmentPropertySource>());
+  // Properties read from several threads once the application runs
+  if (const auto concurrent = getPropertyAsString("properties.concurrent"); concurrent == "true" || concurrent == "1") {
+    enableConcurrentPropertyAccess();
+  }
+
+  // Beans looked up from several threads once the application runs
+  if (const auto concurrent = getPropertyAsString("beans.concurrent"); concurrent == "true" || concurrent == "1") {
+    enableConcurrentAccess();
+  }
+
+  // Build the beans defined through defineBean, independent ones in parallel
+  const auto threads = getPropertyAsInt("beans.init.threads", static_cast<int>(std::thread::hardware_concurrency()));
+  _initialization_report = initializeEagerBeans(static_cast<std::size_t>(std::max(threads, 1)));
+
+  if (!_initialization_report.unresolved.empty()) {
+    _my_logger->error("Dependency cycle between the beans {}", fmt::join(_initialization_report.unresolved, ", "));
+    std::abort();
+  }
+
+  if (_initialization_report.built != 0) {
+    std::string criticalPath;
+    for (const auto &step: _initialization_report.criticalPath) {
+      fmt::format_to(std::back_inserter(criticalPath), "{}{} ({})", criticalPath.empty() ? "" : " -> ", step.name,
+                     std::chrono::duration_cast<std::chrono::microseconds>(step.duration));
+    }
+    _my_logger->info("Built {} beans in {}, critical path: {}", _initialization_report.built,
+                     std::chrono::duration_cast<std::chrono::microseconds>(_initialization_report.elapsed), criticalPath);
+  }
+}
+
+std::shared_ptr<ApplicationContext> DefaultApplicationContext::createChildContext(std::string name) {
+  return std::make_shared<DefaultApplicationContext>(*this, std::move(name));
 }
 
 void DefaultApplicationContext::applicationContextAwareCreated(ApplicationContextAware *aware) {
   aware->setApplicationContext(*this);
 }
+
+void *DefaultApplicationContext::getBeanTypeByName(const BeanType &type, std::string_view view) {
+  if (const auto bean = DefaultBeanFactoryImpl::getBeanTypeByName(type, view); bean != nullptr || _parent == nullptr) {
+    return bean;
+  }
+  return _parent->getBeanTypeByName(type, view);
+}
+
+void *DefaultApplicationContext::getFirstBeanOfType(const BeanType &type) {
+  if (const auto bean = DefaultBeanFactoryImpl::getFirstBeanOfType(type); bean != nullptr || _parent == nullptr) {
+    return bean;
+  }
+
+  const std::lock_guard lock(_parent_mutex);
+  auto [it, inserted] = _parent_beans.try_emplace(type.id());
+  auto &cached = it->second;
+  if (inserted) {
+    cached.generation = &_parent->firstBeanGeneration(type);
+  } else if (cached.generation->load(std::memory_order_acquire) == cached.seen) {
+    return cached.bean;
+  }
+
+  // Read the generation first so a concurrent change is picked up by the next lookup
+  cached.seen = cached.generation->load(std::memory_order_acquire);
+  cached.bean = _parent->getFirstBeanOfType(type);
+  return cached.bean;
+}
+
+std::shared_ptr<std::atomic<std::uint64_t>> DefaultApplicationContext::makeFirstBeanGeneration(const BeanType &type) {
+  // The counter of the root, reached through each parent so that they all bump it too
+  if (_parent != nullptr) {
+    return _parent->sharedFirstBeanGeneration(type);
+  }
+  return DefaultBeanFactoryImpl::makeFirstBeanGeneration(type);
+}
+
+std::vector<void *> DefaultApplicationContext::getBeansOfType(const BeanType &type) {
+  auto beans = DefaultBeanFactoryImpl::getBeansOfType(type);
+  if (_parent != nullptr) {
+    const auto inherited = _parent->getBeansOfType(type);
+    beans.insert(beans.end(), inherited.begin(), inherited.end());
+  }
+  return beans;
+}
+
+const PropertySource::Value &DefaultApplicationContext::parentProperty(std::string_view propertyName, std::uint64_t generation) {
+  if (generation != _parent_properties_seen) {
+    _parent_properties.clear();
+    _parent_properties_seen = generation;
+  }
+
+  if (const auto it = _parent_properties.find(propertyName); it != _parent_properties.end()) {
+    return it->second;
+  }
+  return _parent_properties.emplace(propertyName, _parent->getProperty(propertyName)).first->second;
+}
+
+PropertySource::Value DefaultApplicationContext::getProperty(std::string_view propertyName) {
+  auto value = CompositingPropertyResolver::getProperty(propertyName);
+  if (_parent == nullptr || !std::holds_alternative<std::monostate>(value)) {
+    return value;
+  }
+
+  // Read before resolving: a change made meanwhile drops the entry at the next lookup
+  const auto generation = _parent->propertyGeneration();
+
+  const std::lock_guard lock(_parent_mutex);
+  return parentProperty(propertyName, generation);
+}
+
+PropertyView DefaultApplicationContext::getPropertyView(std::string_view propertyName) {
+  auto view = CompositingPropertyResolver::getPropertyView(propertyName);
+  if (_parent == nullptr || !std::holds_alternative<std::monostate>(view.value())) {
+    return view;
+  }
+
+  // The parent shares its own value, the copies cached here may be dropped by the next lookup
+  return _parent->getPropertyView(propertyName);
+}
+
+TypedValue DefaultApplicationContext::getTypedProperty(std::string_view propertyName) {
+  auto typed = CompositingPropertyResolver::getTypedProperty(propertyName);
+  if (_parent == nullptr || typed.integer || typed.integer.error() != PropertyError::MISSING) {
+    return typed;
+  }
+
+  // Parsed and cached by the parent already
+  return _parent->getTypedProperty(propertyName);
+}
+
+std::uint64_t DefaultApplicationContext::propertyGeneration() const {
+  const auto own = CompositingPropertyResolver::propertyGeneration();
+  return _parent != nullptr ? own + _parent->propertyGeneration() : own;
+}
+
+bool DefaultApplicationContext::isBeanKnown(void *beanPtr) const {
+  return DefaultBeanFactoryImpl::isBeanKnown(beanPtr) || (_parent != nullptr && _parent->isBeanKnown(beanPtr));
+}
+
+BeanFactory::BeanNameT DefaultApplicationContext::beanName(void *beanPtr) const {
+  if (const auto name = DefaultBeanFactoryImpl::beanName(beanPtr); !name.empty() || _parent == nullptr) {
+    return name;
+  }
+  return _parent->beanName(beanPtr);
+}
 }// namespace framework::impl
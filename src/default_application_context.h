@@ -1,7 +1,15 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
 #include <set>
+#include <string>
+#include <unordered_map>
 #include <spdlog/spdlog.h>
 
 #include "compositing_property_resolver.h"
@@ -11,26 +19,82 @@
 namespace framework::impl {
 /**
  * Class DefaultApplicationContext
+ *
+ * A child context (see createChildContext) looks its own beans and property sources up first and
+ * then asks its parent. The first bean of each type and the property values found in the parent
+ * are cached in the child, and checked against the parent's generation counters on each hit.
+ *
+ * Every context of a tree shares the first bean generation counters of its root: the changes of a
+ * child bump them as well as those of its parents, so a BeanRef on a child, and the child's own
+ * cache, follow the whole chain. Changes in one child only cost its siblings a refresh.
+ *
+ * The parent must outlive its children. When it is owned by a shared_ptr, as the contexts created
+ * by ApplicationContext::Create and createChildContext are, the child keeps it alive; otherwise
+ * the child only holds a plain pointer to it.
  */
 class DefaultApplicationContext : public ApplicationContext,
                                   public CompositingPropertyResolver,
-                                  public DefaultBeanFactoryImpl {
+                                  public DefaultBeanFactoryImpl,
+                                  public std::enable_shared_from_this<DefaultApplicationContext> {
+  /// First bean of a type in the parent, valid while the parent's generation for the type is seen
+  struct ParentBean {
+    const std::atomic<std::uint64_t> *generation;
+    std::uint64_t seen;
+    void *bean;
+  };
+
+  /// nullptr for a root context
+  DefaultApplicationContext *_parent = nullptr;
+  /// Keeps the parent alive when it is owned by a shared_ptr, empty otherwise
+  std::shared_ptr<DefaultApplicationContext> _parent_owner;
+  /// Guards the caches of parent lookups below
+  std::mutex _parent_mutex;
+  /// First beans of the parent by type id
+  std::unordered_map<std::size_t, ParentBean> _parent_beans;
+  /// Property values resolved by the parent, misses included
+  std::map<std::string, PropertySource::Value, std::less<>> _parent_properties;
+  /// Parent property generation _parent_properties was filled at
+  std::uint64_t _parent_properties_seen = 0;
+
+  /// Cached value of a property in the parent; _parent_mutex must be held
+  const PropertySource::Value &parentProperty(std::string_view propertyName, std::uint64_t generation);
+
   std::shared_ptr<spdlog::logger> _my_logger;
   std::string _name;
   std::set<std::string> _enabledProfiles;
+  /// Arena the beans of this context are allocated from, released once they are all destroyed
+  std::pmr::monotonic_buffer_resource _bean_arena;
+  /// Pool the prototypes of this context are allocated from, destroyed ones give their memory back
+  std::pmr::synchronized_pool_resource _prototype_pool;
+  /// What initialize() built eagerly
+  BeanInitializationReport _initialization_report;
 
 protected:
   void applicationContextAwareCreated(ApplicationContextAware *aware) override;
+  void *getBeanTypeByName(const BeanType &type, std::string_view view) override;
+  void *getFirstBeanOfType(const BeanType &type) override;
+  std::vector<void *> getBeansOfType(const BeanType &type) override;
+  std::shared_ptr<std::atomic<std::uint64_t>> makeFirstBeanGeneration(const BeanType &type) override;
 
 public:
   explicit DefaultApplicationContext(std::string name);
+  /// Creates a child of parent, see createChildContext
+  DefaultApplicationContext(DefaultApplicationContext &parent, std::string name);
   ~DefaultApplicationContext() override;
 
   void initialize() override;
-  ApplicationContext *getParentContext() const override { return nullptr; }
+  ApplicationContext *getParentContext() const override { return _parent; }
+  std::shared_ptr<ApplicationContext> createChildContext(std::string name) override;
+  PropertySource::Value getProperty(std::string_view propertyName) override;
+  PropertyView getPropertyView(std::string_view propertyName) override;
+  TypedValue getTypedProperty(std::string_view propertyName) override;
+  std::uint64_t propertyGeneration() const override;
+  bool isBeanKnown(void *beanPtr) const override;
+  BeanNameT beanName(void *beanPtr) const override;
   void addActiveProfile(std::string profile) { _enabledProfiles.emplace(std::move(profile)); }
   std::string_view name() const override { return _name; }
   const std::set<std::string> &activeProfiles() const override { return _enabledProfiles; }
+  const BeanInitializationReport &initializationReport() const { return _initialization_report; }
 };
 
 }// namespace framework::impl
@@ -1,71 +1,702 @@
 
 #include "default_bean_factory_impl.h"
+#include "work_stealing_pool.h"
 #include <algorithm>
-#include <fmt/format.h>
+#include <charconv>
+#include <exception>
+#include <mutex>
+#include <utility>
+#include <ranges>
 
 namespace {
   std::string EMPTY_STRING{};
+
+  void appendNumber(std::string &str, std::size_t number) {
+    char buffer[24];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), number);
+    str.append(buffer, result.ptr);
+  }
 }
 
 namespace framework::impl {
-  bool DefaultBeanFactoryImpl::registerBean(const boost::typeindex::ctti_type_index &type, void *bean,
-                                            deleter_t deleter, std::string &&name) {
-    // Make sure the name is unique
-    auto findname = std::ranges::find_if(_bean_holder, [name](const auto &holder) { return holder.name == name; });
+  DefaultBeanFactoryImpl::DefaultBeanFactoryImpl(std::pmr::memory_resource *resource)
+      : _bean_resource(resource),
+        _thread_scopes(std::make_shared<ThreadScopeRegistry>()) {
+  }
+
+  DefaultBeanFactoryImpl::~DefaultBeanFactoryImpl() {
+    destroyBeans();
+  }
+
+  std::pmr::memory_resource *DefaultBeanFactoryImpl::beanMemoryResource() {
+    return _concurrent.load(std::memory_order_acquire) ? &_locked_resource : _bean_resource;
+  }
+
+  void DefaultBeanFactoryImpl::setBeanMemoryResource(std::pmr::memory_resource *resource) {
+    const std::lock_guard lock(_writer_mutex);
+    _bean_resource = resource;
+    _locked_resource.setUpstream(resource);
+  }
+
+  std::pmr::memory_resource *DefaultBeanFactoryImpl::prototypeMemoryResource() {
+    return _prototype_resource;
+  }
+
+  void DefaultBeanFactoryImpl::setPrototypeMemoryResource(std::pmr::memory_resource *resource) {
+    const std::lock_guard lock(_writer_mutex);
+    _prototype_resource = resource;
+  }
+
+  void DefaultBeanFactoryImpl::enableConcurrentAccess() {
+    const std::lock_guard lock(_writer_mutex);
+    if (_concurrent.load(std::memory_order_relaxed)) {
+      return;
+    }
+
+    // Beans allocated so far are released through the locking adaptor as well
+    _locked_resource.setUpstream(_bean_resource);
+    for (auto &holder: _bean_holder) {
+      if (holder.resource == _bean_resource) {
+        holder.resource = &_locked_resource;
+      }
+    }
+
+    // Lookups only switch to the snapshot once there is one
+    _epoch = std::make_unique<EpochDomain>();
+    replaceSnapshot();
+    _concurrent.store(true, std::memory_order_release);
+  }
+
+  void DefaultBeanFactoryImpl::publishSnapshot() {
+    if (_concurrent.load(std::memory_order_relaxed)) {
+      replaceSnapshot();
+    }
+  }
+
+  void DefaultBeanFactoryImpl::replaceSnapshot() {
+    auto next = std::make_unique<BeanIndexSnapshot>();
+    next->byName.reserve(_bean_by_name.size());
+    for (const auto &[name, holder]: _bean_by_name) {
+      next->byName.emplace(name->name, &*holder);
+    }
+    next->byPtr.reserve(_bean_by_ptr.size());
+    for (const auto &[bean, holder]: _bean_by_ptr) {
+      next->byPtr.emplace(bean, &*holder);
+    }
+    next->byType.reserve(_bean_by_type.size());
+    next->byInterface.reserve(_bean_by_type.size());
+    next->pools.reserve(_bean_by_type.size());
+    for (const auto &typeBucket: _bean_by_type) {
+      next->byType.push_back(typeBucket.beans);
+      next->byInterface.push_back(typeBucket.implementations);
+      next->pools.push_back(typeBucket.pool.get());
+    }
+
+    // Lookups that may still read the previous snapshot are done once synchronize returns
+    const auto previous = _snapshot.exchange(next.release(), std::memory_order_acq_rel);
+    _epoch->synchronize();
+    delete previous;
+  }
+
+  BeanInitializationReport DefaultBeanFactoryImpl::initializeEagerBeans(std::size_t threads) {
+    using Clock = std::chrono::steady_clock;
+
+    struct Node {
+      void *bean = nullptr;
+      std::shared_ptr<LazyBean> lazy;
+      std::string name;
+      std::vector<std::size_t> dependencies;
+      std::vector<std::size_t> dependents;
+      std::atomic<std::size_t> waitingFor{0};
+      Clock::time_point start;
+      Clock::time_point end;
+    };
+
+    BeanInitializationReport report;
+
+    // Gather the definitions still to build, by value: they may be removed while others are built
+    std::vector<const BeanHolder *> eager;
+    std::vector<Node> nodes;
+    {
+      const std::lock_guard lock(_writer_mutex);
+      for (const auto &holder: _bean_holder) {
+        if (holder.lazy && holder.lazy->eager() && !holder.lazy->constructed()) {
+          eager.push_back(&holder);
+        }
+      }
+      nodes = std::vector<Node>(eager.size());
+      for (std::size_t i = 0; i < nodes.size(); i++) {
+        nodes[i].bean = eager[i]->bean;
+        nodes[i].lazy = eager[i]->lazy;
+        nodes[i].name = eager[i]->name->name;
+      }
+    }
+    if (nodes.empty()) {
+      return report;
+    }
+
+    std::unordered_map<std::string_view, std::size_t> byName;
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+      byName.emplace(nodes[i].name, i);
+    }
+
+    // Only edges between eager definitions; other dependencies are built on demand
+    for (std::size_t i = 0; i < nodes.size(); i++) {
+      for (const auto &dependency: nodes[i].lazy->dependsOn()) {
+        if (const auto it = byName.find(dependency); it != byName.end()) {
+          nodes[i].dependencies.push_back(it->second);
+          nodes[it->second].dependents.push_back(i);
+        }
+      }
+      nodes[i].waitingFor.store(nodes[i].dependencies.size(), std::memory_order_relaxed);
+    }
+
+    // Topological order, whatever is left out is stuck behind a cycle
+    std::vector<std::size_t> order;
+    {
+      std::vector<std::size_t> remaining(nodes.size());
+      for (std::size_t i = 0; i < nodes.size(); i++) {
+        remaining[i] = nodes[i].dependencies.size();
+        if (remaining[i] == 0) {
+          order.push_back(i);
+        }
+      }
+      for (std::size_t k = 0; k < order.size(); k++) {
+        for (const auto dependent: nodes[order[k]].dependents) {
+          if (--remaining[dependent] == 0) {
+            order.push_back(dependent);
+          }
+        }
+      }
+      if (order.size() != nodes.size()) {
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+          if (remaining[i] != 0) {
+            report.unresolved.emplace_back(nodes[i].name);
+          }
+        }
+        return report;
+      }
+    }
 
-    if (findname != _bean_holder.end()) {
-      // Name conflict
+    const auto begin = Clock::now();
+    // Outside concurrent mode the indexes are not safe to read while a factory on another thread
+    // builds a lazy dependency, so everything is built here
+    if (threads <= 1 || nodes.size() <= 1 || !_concurrent.load(std::memory_order_acquire)) {
+      for (const auto i: order) {
+        nodes[i].start = Clock::now();
+        resolve(nodes[i].bean, nodes[i].lazy);
+        nodes[i].end = Clock::now();
+      }
+    } else {
+      std::mutex failureMutex;
+      std::exception_ptr failure;
+      {
+        WorkStealingPool pool(std::min(threads, nodes.size()));
+        std::function<void(std::size_t)> build = [&](std::size_t i) {
+          auto &node = nodes[i];
+          node.start = Clock::now();
+          try {
+            resolve(node.bean, node.lazy);
+          } catch (...) {
+            const std::lock_guard lock(failureMutex);
+            if (!failure) {
+              failure = std::current_exception();
+            }
+            return;
+          }
+          node.end = Clock::now();
+
+          for (const auto dependent: node.dependents) {
+            if (nodes[dependent].waitingFor.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+              pool.submit([&build, dependent] { build(dependent); });
+            }
+          }
+        };
+
+        for (std::size_t i = 0; i < nodes.size(); i++) {
+          if (nodes[i].dependencies.empty()) {
+            pool.submit([&build, i] { build(i); });
+          }
+        }
+        pool.wait();
+      }
+
+      if (failure) {
+        std::rethrow_exception(failure);
+      }
+    }
+    report.elapsed = Clock::now() - begin;
+    report.built = nodes.size();
+
+    // Walk back from the bean done last, through the dependency each bean waited for the longest
+    auto last = order.front();
+    for (const auto i: order) {
+      last = nodes[i].end > nodes[last].end ? i : last;
+    }
+    for (auto current = last;;) {
+      const auto &node = nodes[current];
+      report.criticalPath.push_back({node.name, node.end - node.start});
+      if (node.dependencies.empty()) {
+        break;
+      }
+      current = *std::ranges::max_element(node.dependencies, {}, [&](std::size_t i) { return nodes[i].end; });
+    }
+    std::ranges::reverse(report.criticalPath);
+    return report;
+  }
+
+  bool DefaultBeanFactoryImpl::destroyBean(void *bean) {
+    std::optional<BeanHolder> holder;
+    {
+      const std::lock_guard lock(_writer_mutex);
+      holder = unregisterBean(bean);
+    }
+
+    if (!holder) {
       return false;
     }
 
-    _bean_holder.emplace_back(bean, deleter, type, std::move(name));
+    // A lookup may still be building it from a definition taken before the removal
+    if (!holder->lazy || holder->lazy->seal()) {
+      holder->ops->destroy(bean);
+    }
+    holder->ops->deallocate(bean, holder->resource);
     return true;
   }
 
-  void DefaultBeanFactoryImpl::deleteBean(void *bean) {
+  void DefaultBeanFactoryImpl::destroyBeans() {
+    // Teardown is single threaded, lookups from the destructors go to the indexes directly
+    _concurrent.store(false, std::memory_order_release);
+    delete _snapshot.exchange(nullptr, std::memory_order_acq_rel);
+    _destroying = true;
+
+    // Pooled and scoped instances are the newest of all, and may use the beans
+    for (auto &typeBucket: _bean_by_type) {
+      typeBucket.pool.reset();
+    }
+    _thread_scopes->close();
+
+    for (auto &holder: std::ranges::reverse_view(_bean_holder)) {
+      // Going newest first, the bean is usually the last one of its bucket; a lazy bean moved to the
+      // end of the destruction order when built but kept its place in the bucket
+      auto &typeBucket = _bean_by_type[holder.type];
+      const auto it = std::find(typeBucket.beans.rbegin(), typeBucket.beans.rend(), holder.bean);
+      const auto wasFirst = std::next(it) == typeBucket.beans.rend();
+      typeBucket.beans.erase(std::next(it).base());
+      if (wasFirst) {
+        typeBucket.firstBeanChanged();
+      }
+      for (const auto interfaceType: holder.interfaces) {
+        if (removeImplementation(interfaceType, holder.bean)) {
+          _bean_by_type[interfaceType].firstBeanChanged();
+        }
+      }
+
+      const auto bean = std::exchange(holder.bean, nullptr);
+      if (!holder.lazy || holder.lazy->seal()) {
+        holder.ops->destroy(bean);
+      }
+      holder.ops->deallocate(bean, holder.resource);
+    }
+
+    _bean_by_ptr.clear();
+    _bean_by_name.clear();
+    _bean_names.clear();
+    _bean_holder.clear();
+    _destroying = false;
+  }
+
+  DefaultBeanFactoryImpl::TypeBucket &DefaultBeanFactoryImpl::bucket(std::size_t type) {
+    if (type >= _bean_by_type.size()) {
+      _bean_by_type.resize(type + 1);
+    }
+    return _bean_by_type[type];
+  }
+
+  const DefaultBeanFactoryImpl::TypeBucket *DefaultBeanFactoryImpl::findBucket(std::size_t type) const {
+    return type < _bean_by_type.size() ? &_bean_by_type[type] : nullptr;
+  }
+
+  bool DefaultBeanFactoryImpl::registerBean(const BeanType &type, void *bean, const BeanOps *ops,
+                                            std::pmr::memory_resource *resource, std::string_view name) {
+    return addBean(type, bean, ops, resource, name, nullptr);
+  }
+
+  bool DefaultBeanFactoryImpl::registerLazyBean(const BeanType &type, void *bean, const BeanOps *ops,
+                                                std::pmr::memory_resource *resource, std::string_view name,
+                                                std::unique_ptr<LazyBean> lazy) {
+    return addBean(type, bean, ops, resource, name, std::move(lazy));
+  }
+
+  bool DefaultBeanFactoryImpl::addBean(const BeanType &type, void *bean, const BeanOps *ops,
+                                       std::pmr::memory_resource *resource, std::string_view name,
+                                       std::unique_ptr<LazyBean> lazy) {
+    const std::lock_guard lock(_writer_mutex);
+
+    // Make sure the bean isn't already managed
+    if (_destroying || _bean_by_ptr.contains(bean)) {
+      return false;
+    }
+
+    // Make sure the name is unique
+    const auto [named, inserted] = _bean_by_name.try_emplace(_bean_names.intern(name));
+    if (!inserted) {
+      return false;
+    }
+
+    // Counted before the snapshot shows the bean, so lookups know to check it
+    const auto pending = lazy != nullptr;
+    if (pending) {
+      _lazy_pending.fetch_add(1, std::memory_order_acq_rel);
+    }
+
+    const auto it = _bean_holder.emplace(_bean_holder.end(), bean, ops, resource, type.id(), named->first, std::move(lazy));
+    it->lazyPending = pending;
+    named->second = it;
+    _bean_by_ptr.emplace(bean, it);
+
+    auto &typeBucket = bucket(type.id());
+    typeBucket.beans.push_back(bean);
+    typeBucket.registered++;
+
+    // BeanRefs refresh from the snapshot, publish it before telling them
+    publishSnapshot();
+    if (typeBucket.beans.size() == 1) {
+      typeBucket.firstBeanChanged();
+    }
+    return true;
+  }
+
+  std::optional<DefaultBeanFactoryImpl::BeanHolder> DefaultBeanFactoryImpl::unregisterBean(void *bean) {
+    // destroyBeans drops everything at once
+    if (_destroying) {
+      return std::nullopt;
+    }
+
     // Find the bean
-    auto findbean = std::ranges::find_if(_bean_holder, [bean](const auto &holder) { return holder.bean == bean; });
+    const auto findbean = _bean_by_ptr.find(bean);
+    if (findbean == _bean_by_ptr.end()) {
+      return std::nullopt;
+    }
+
+    const auto holder = findbean->second;
+    auto firstChanged = false;
+
+    // Beans are usually removed newest first, so search the bucket from the back
+    auto &typeBucket = bucket(holder->type);
+    auto &beans = typeBucket.beans;
+    if (const auto it = std::ranges::find(beans.rbegin(), beans.rend(), bean); it != beans.rend()) {
+      firstChanged = beans.erase(std::next(it).base()) == beans.begin();
+    }
+
+    std::vector<std::size_t> interfacesChanged;
+    for (const auto interfaceType: holder->interfaces) {
+      if (removeImplementation(interfaceType, bean)) {
+        interfacesChanged.push_back(interfaceType);
+      }
+    }
+
+    _bean_by_ptr.erase(findbean);
+    _bean_by_name.erase(holder->name);
+
+    // The previous snapshot still points at the entry and its name
+    publishSnapshot();
+    if (firstChanged) {
+      typeBucket.firstBeanChanged();
+    }
+    for (const auto interfaceType: interfacesChanged) {
+      _bean_by_type[interfaceType].firstBeanChanged();
+    }
+
+    if (std::exchange(holder->lazyPending, false)) {
+      _lazy_pending.fetch_sub(1, std::memory_order_acq_rel);
+    }
+
+    auto removed = std::move(*holder);
+    _bean_names.erase(holder->name);
+    _bean_holder.erase(holder);
+    return removed;
+  }
+
+  bool DefaultBeanFactoryImpl::removeImplementation(std::size_t interfaceType, void *bean) {
+    auto &implementations = _bean_by_type[interfaceType].implementations;
+    if (const auto it = std::ranges::find(implementations.rbegin(), implementations.rend(), bean, &Implementation::bean);
+        it != implementations.rend()) {
+      return implementations.erase(std::next(it).base()) == implementations.begin();
+    }
+    return false;
+  }
+
+  void DefaultBeanFactoryImpl::registerBeanInterface(void *bean, const BeanType &interfaceType, AdjustToInterface adjust) {
+    const std::lock_guard lock(_writer_mutex);
+    const auto findbean = _bean_by_ptr.find(bean);
+    if (_destroying || findbean == _bean_by_ptr.end()) {
+      return;
+    }
+
+    // Lazy beans are indexed when defined, and again by the dependency handling once built
+    auto &interfaces = findbean->second->interfaces;
+    if (std::ranges::find(interfaces, interfaceType.id()) != interfaces.end()) {
+      return;
+    }
+
+    interfaces.push_back(interfaceType.id());
+    auto &typeBucket = bucket(interfaceType.id());
+    typeBucket.implementations.push_back({bean, adjust});
+
+    publishSnapshot();
+    if (typeBucket.implementations.size() == 1) {
+      typeBucket.firstBeanChanged();
+    }
+  }
+
+  void DefaultBeanFactoryImpl::deleteBean(void *bean) {
+    std::optional<BeanHolder> holder;
+    {
+      const std::lock_guard lock(_writer_mutex);
+      holder = unregisterBean(bean);
+    }
+
+    // The caller releases the storage, a lookup must not be building into it by then
+    if (holder && holder->lazy) {
+      holder->lazy->seal();
+    }
+  }
+
+  void *DefaultBeanFactoryImpl::resolve(void *bean, const std::shared_ptr<LazyBean> &lazy) {
+    if (lazy->constructed()) {
+      return bean;
+    }
+
+    // Nothing gets built anymore once the factory is torn down
+    if (_destroying) {
+      return nullptr;
+    }
 
-    if (findbean != _bean_holder.end()) {
-      _bean_holder.erase(findbean);
+    if (lazy->ensureConstructed(bean, *this)) {
+      // Destroy it after the beans it may have looked up while being built, unless it was removed
+      // meanwhile and the storage now holds another bean
+      const std::lock_guard lock(_writer_mutex);
+      if (const auto it = _bean_by_ptr.find(bean); it != _bean_by_ptr.end() && it->second->lazy == lazy) {
+        _bean_holder.splice(_bean_holder.end(), _bean_holder, it->second);
+        if (std::exchange(it->second->lazyPending, false)) {
+          _lazy_pending.fetch_sub(1, std::memory_order_acq_rel);
+        }
+      }
     }
+
+    // Sealed by a removal before it could be built
+    return lazy->constructed() ? bean : nullptr;
   }
 
   void *DefaultBeanFactoryImpl::getFirstBeanOfType(const BeanType &type) {
-    const auto it = std::ranges::find_if(_bean_holder, [type](const auto &holder) { return holder.type == type; });
-    if (it != _bean_holder.end()) {
-      return it->bean;
+    void *bean = nullptr;
+    AdjustToInterface adjust = nullptr;
+    std::shared_ptr<LazyBean> lazy;
+
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      const auto &index = *_snapshot.load(std::memory_order_acquire);
+      if (type.id() < index.byType.size() && !index.byType[type.id()].empty()) {
+        bean = index.byType[type.id()].front();
+      } else if (type.id() < index.byInterface.size() && !index.byInterface[type.id()].empty()) {
+        const auto &implementation = index.byInterface[type.id()].front();
+        bean = implementation.bean;
+        adjust = implementation.adjust;
+      }
+      if (bean != nullptr && _lazy_pending.load(std::memory_order_acquire) != 0) {
+        lazy = index.byPtr.find(bean)->second->lazy;
+      }
+    } else {
+      if (const auto typeBucket = findBucket(type.id()); typeBucket != nullptr && !typeBucket->beans.empty()) {
+        bean = typeBucket->beans.front();
+      } else if (typeBucket != nullptr && !typeBucket->implementations.empty()) {
+        const auto &implementation = typeBucket->implementations.front();
+        bean = implementation.bean;
+        adjust = implementation.adjust;
+      }
+      if (bean != nullptr && _lazy_pending.load(std::memory_order_acquire) != 0) {
+        lazy = _bean_by_ptr.find(bean)->second->lazy;
+      }
     }
-    return nullptr;
+
+    // Building a lazy bean may register others, so never under the pin
+    if (lazy) {
+      bean = resolve(bean, lazy);
+    }
+    return bean != nullptr && adjust != nullptr ? adjust(bean) : bean;
   }
 
-  std::string DefaultBeanFactoryImpl::makeDefaultBeanName(const BeanType &type) {
-    auto count = std::ranges::count_if(_bean_holder, [type](const auto &holder) { return holder.type == type; });
+  std::vector<void *> DefaultBeanFactoryImpl::getBeansOfType(const BeanType &type) {
+    std::vector<void *> beans;
+    std::vector<Implementation> implementations;
+    std::vector<std::shared_ptr<LazyBean>> lazies;
 
-    return fmt::format("{}_{}", type.name(), count);
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      const auto &index = *_snapshot.load(std::memory_order_acquire);
+      if (type.id() < index.byType.size()) {
+        beans = index.byType[type.id()];
+        implementations = index.byInterface[type.id()];
+      }
+      if (_lazy_pending.load(std::memory_order_acquire) != 0) {
+        for (const auto bean: beans) {
+          lazies.push_back(index.byPtr.find(bean)->second->lazy);
+        }
+        for (const auto &implementation: implementations) {
+          lazies.push_back(index.byPtr.find(implementation.bean)->second->lazy);
+        }
+      }
+    } else {
+      if (const auto typeBucket = findBucket(type.id())) {
+        beans = typeBucket->beans;
+        implementations = typeBucket->implementations;
+      }
+      if (_lazy_pending.load(std::memory_order_acquire) != 0) {
+        for (const auto bean: beans) {
+          lazies.push_back(_bean_by_ptr.find(bean)->second->lazy);
+        }
+        for (const auto &implementation: implementations) {
+          lazies.push_back(_bean_by_ptr.find(implementation.bean)->second->lazy);
+        }
+      }
+    }
+
+    // Implementations come after the beans of the type itself, and are adjusted once built
+    const auto own = beans.size();
+    beans.reserve(own + implementations.size());
+    for (const auto &implementation: implementations) {
+      beans.push_back(implementation.bean);
+    }
+    for (std::size_t i = 0; i < lazies.size(); i++) {
+      if (lazies[i]) {
+        beans[i] = resolve(beans[i], lazies[i]);
+      }
+    }
+    for (std::size_t i = own; i < beans.size(); i++) {
+      if (beans[i] != nullptr) {
+        beans[i] = implementations[i - own].adjust(beans[i]);
+      }
+    }
+    std::erase(beans, nullptr);
+    return beans;
+  }
+
+  const std::atomic<std::uint64_t> &DefaultBeanFactoryImpl::firstBeanGeneration(const BeanType &type) {
+    return *sharedFirstBeanGeneration(type);
+  }
+
+  std::shared_ptr<std::atomic<std::uint64_t>> DefaultBeanFactoryImpl::sharedFirstBeanGeneration(const BeanType &type) {
+    const std::lock_guard lock(_writer_mutex);
+    auto &typeBucket = bucket(type.id());
+    if (!typeBucket.firstBeanGeneration) {
+      typeBucket.firstBeanGeneration = makeFirstBeanGeneration(type);
+    }
+    return typeBucket.firstBeanGeneration;
+  }
+
+  std::shared_ptr<std::atomic<std::uint64_t>> DefaultBeanFactoryImpl::makeFirstBeanGeneration(const BeanType &) {
+    return std::make_shared<std::atomic<std::uint64_t>>(0);
+  }
+
+  BeanPoolBase *DefaultBeanFactoryImpl::findBeanPool(const BeanType &type) {
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      const auto &pools = _snapshot.load(std::memory_order_acquire)->pools;
+      return type.id() < pools.size() ? pools[type.id()] : nullptr;
+    }
+
+    const auto typeBucket = findBucket(type.id());
+    return typeBucket != nullptr ? typeBucket->pool.get() : nullptr;
+  }
+
+  BeanPoolBase &DefaultBeanFactoryImpl::addBeanPool(const BeanType &type, std::unique_ptr<BeanPoolBase> pool) {
+    const std::lock_guard lock(_writer_mutex);
+    auto &typeBucket = bucket(type.id());
+    if (!typeBucket.pool) {
+      typeBucket.pool = std::move(pool);
+      publishSnapshot();
+    }
+    return *typeBucket.pool;
+  }
+
+  ScopedBeans &DefaultBeanFactoryImpl::threadScopedBeans() {
+    return ThreadScopeRegistry::beansOfThisThread(_thread_scopes);
+  }
+
+  std::string_view DefaultBeanFactoryImpl::makeDefaultBeanName(const BeanType &type) {
+    // The name is registered right after, on the same thread
+    thread_local std::string defaultName;
+
+    const std::lock_guard lock(_writer_mutex);
+    auto &typeBucket = bucket(type.id());
+    if (typeBucket.defaultNamePrefix.empty()) {
+      typeBucket.defaultNamePrefix = std::string(type.name()) + '_';
+    }
+
+    // <type>_<count>, skipping over names that were taken explicitly
+    // skipping over names handed out to threads that have not registered them yet
+    auto count = std::max(typeBucket.registered, typeBucket.nextDefaultName);
+    do {
+      defaultName = typeBucket.defaultNamePrefix;
+      appendNumber(defaultName, count++);
+    } while (_bean_names.find(defaultName) != nullptr);
+
+    typeBucket.nextDefaultName = count;
+    return defaultName;
   }
 
   void *DefaultBeanFactoryImpl::getBeanTypeByName(const BeanType &type, std::string_view view) {
-    const auto it = std::ranges::find_if(
-        _bean_holder, [type, view](const auto &holder) { return holder.type == type && holder.name == view; });
+    if (_concurrent.load(std::memory_order_acquire)) {
+      void *bean = nullptr;
+      std::shared_ptr<LazyBean> lazy;
+      {
+        const auto guard = _epoch->pin();
+        const auto &byName = _snapshot.load(std::memory_order_acquire)->byName;
+        if (const auto it = byName.find(view); it != byName.end() && it->second->type == type.id()) {
+          bean = it->second->bean;
+          lazy = it->second->lazy;
+        }
+      }
+      return lazy ? resolve(bean, lazy) : bean;
+    }
+
+    const auto name = _bean_names.find(view);
+    if (name == nullptr) {
+      return nullptr;
+    }
 
-    if (it != _bean_holder.end()) {
-      return it->bean;
+    const auto it = _bean_by_name.find(name);
+
+    if (it != _bean_by_name.end() && it->second->type == type.id()) {
+      return it->second->lazy ? resolve(it->second->bean, it->second->lazy) : it->second->bean;
     }
 
     return nullptr;
   }
 
   bool DefaultBeanFactoryImpl::isBeanKnown(void *beanPtr) const {
-    return std::ranges::any_of(_bean_holder, [beanPtr](const auto &holder) { return holder.bean == beanPtr; });
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      return _snapshot.load(std::memory_order_acquire)->byPtr.contains(beanPtr);
+    }
+
+    const auto it = _bean_by_ptr.find(beanPtr);
+    return it != _bean_by_ptr.end() && it->second->bean != nullptr;
   }
 
   BeanFactory::BeanNameT DefaultBeanFactoryImpl::beanName(void *beanPtr) const {
-    const auto it =
-        std::ranges::find_if(_bean_holder, [beanPtr](const auto &holder) { return holder.bean == beanPtr; });
+    if (_concurrent.load(std::memory_order_acquire)) {
+      const auto guard = _epoch->pin();
+      const auto &byPtr = _snapshot.load(std::memory_order_acquire)->byPtr;
+      const auto it = byPtr.find(beanPtr);
+      return it != byPtr.end() ? it->second->name->name : EMPTY_STRING;
+    }
+
+    const auto it = _bean_by_ptr.find(beanPtr);
 
-    if (it != _bean_holder.end()) {
-      return it->name;
+    if (it != _bean_by_ptr.end() && it->second->bean != nullptr) {
+      return it->second->name->name;
     }
 
     return EMPTY_STRING;
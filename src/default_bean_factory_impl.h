@@ -1,33 +1,258 @@
 
 #pragma once
+#include "epoch_domain.h"
+#include "locking_memory_resource.h"
+#include "name_interner.h"
 #include "sproutpp/bean_factory.h"
+#include "thread_scope_registry.h"
 
+#include <chrono>
 #include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace framework::impl {
 
+/**
+ * Outcome of DefaultBeanFactoryImpl::initializeEagerBeans
+ */
+struct BeanInitializationReport {
+  struct Step {
+    std::string name;
+    std::chrono::nanoseconds duration;
+  };
+
+  /// Number of beans built
+  std::size_t built = 0;
+  /// Wall-clock time of the whole initialization
+  std::chrono::nanoseconds elapsed{};
+  /// Chain of beans that bounded the total time, each one waiting for the previous one
+  std::vector<Step> criticalPath;
+  /// Beans not built because they are part of, or depend on, a dependency cycle
+  std::vector<std::string> unresolved;
+};
+
 /**
  * Class DefaultBeanFactoryImpl
+ *
+ * Beans are kept in registration order in a node-based list and indexed by name and by
+ * bean pointer, so registration, name lookups and deletion are O(1) on average. Bean names are
+ * interned with their hash, the name index compares interned pointers rather than strings.
+ * Type-based lookups go through per-type buckets indexed by the dense BeanType id. A bucket also
+ * lists, already adjusted, the beans implementing its type as one of their BeanInterfaces.
+ *
+ * Beans still registered when the factory is torn down are destroyed in reverse registration
+ * order, before the memory resource they were allocated from is released.
+ *
+ * Lazy beans are registered like the others but only built by the first lookup handing them out.
+ * Once built they move to the end of the destruction order, after the beans they may depend on.
+ *
+ * Registration and deletion are serialized internally. Lookups are not synchronized unless
+ * enableConcurrentAccess() was called: from then on every change publishes an immutable copy of the
+ * indexes and lookups read that copy under an EpochDomain pin, so they never block on writers.
+ * Each change then costs a copy of the indexes, so concurrent access is best enabled once the
+ * bulk of the beans is registered.
  */
 class DefaultBeanFactoryImpl : public virtual BeanFactory {
+  /// Registry entry
   struct BeanHolder {
+    /// nullptr once destroyed by destroyBeans
     void *bean;
-    deleter_t deleter;
-    boost::typeindex::ctti_type_index type;
-    std::string name;
+    const BeanOps *ops;
+    std::pmr::memory_resource *resource;
+    std::size_t type;
+    const NameInterner::InternedName *name;
+    /// Set for beans defined through defineLazyBean; shared with the lookups building the bean, so
+    /// that it outlives a concurrent removal
+    std::shared_ptr<LazyBean> lazy;
+    /// Whether the lazy bean is counted in _lazy_pending; guarded by _writer_mutex
+    bool lazyPending = false;
+    /// Type ids of the interfaces the bean is indexed under
+    std::vector<std::size_t> interfaces;
   };
 
-  std::list<BeanHolder> _bean_holder;
+  /// A bean indexed under an interface, converted by adjust once built
+  struct Implementation {
+    void *bean;
+    AdjustToInterface adjust;
+  };
+
+  struct TypeBucket {
+    /// Beans of this type, in registration order
+    std::vector<void *> beans;
+    /// Beans implementing this type as an interface, in registration order
+    std::vector<Implementation> implementations;
+    /// Number of beans of this type registered so far, used for default names
+    std::size_t registered = 0;
+    /// Lowest number makeDefaultBeanName may hand out next
+    std::size_t nextDefaultName = 0;
+    /// "<type name>_", built the first time a default name is needed
+    std::string defaultNamePrefix;
+    /// Bumped when the first bean changes, allocated once a BeanRef asks for it; may be shared with
+    /// other factories, see makeFirstBeanGeneration
+    std::shared_ptr<std::atomic<std::uint64_t>> firstBeanGeneration;
+    /// Recycled prototype instances, created by the first getBeanPool
+    std::unique_ptr<BeanPoolBase> pool;
+
+    void firstBeanChanged() const {
+      if (firstBeanGeneration) {
+        firstBeanGeneration->fetch_add(1, std::memory_order_release);
+      }
+    }
+  };
+
+  using BeanHolderList = std::list<BeanHolder>;
+
+  /// Immutable copy of the indexes, read by lookups in concurrent mode
+  struct BeanIndexSnapshot {
+    std::unordered_map<std::string_view, const BeanHolder *> byName;
+    std::unordered_map<const void *, const BeanHolder *> byPtr;
+    std::vector<std::vector<void *>> byType;
+    std::vector<std::vector<Implementation>> byInterface;
+    std::vector<BeanPoolBase *> pools;
+  };
+
+  /// All beans, in registration order
+  BeanHolderList _bean_holder;
+  /// Storage for the bean names
+  NameInterner _bean_names;
+  /// Index by interned bean name
+  std::unordered_map<const NameInterner::InternedName *, BeanHolderList::iterator, NameInterner::Hash> _bean_by_name;
+  /// Index by bean pointer
+  std::unordered_map<const void *, BeanHolderList::iterator> _bean_by_ptr;
+  /// Per-type buckets, indexed by BeanType::id()
+  std::vector<TypeBucket> _bean_by_type;
+  /// Where createSingleton and the lazy beans allocate from
+  std::pmr::memory_resource *_bean_resource;
+  /// Where getNewInstance allocates from, hands memory back when an instance is destroyed
+  std::pmr::memory_resource *_prototype_resource = std::pmr::get_default_resource();
+  /// Set while destroyBeans runs, the indexes are not maintained bean by bean meanwhile
+  bool _destroying = false;
+  /// Number of lazy beans not built yet; lookups skip the lazy check while it is zero
+  std::atomic<std::size_t> _lazy_pending{0};
+
+  /// Serializes every change to the indexes above
+  std::mutex _writer_mutex;
+  /// Whether lookups go through the published snapshot
+  std::atomic<bool> _concurrent{false};
+  /// Last published snapshot, only set in concurrent mode
+  std::atomic<const BeanIndexSnapshot *> _snapshot{nullptr};
+  /// Tracks the lookups still reading a snapshot, only created in concurrent mode
+  std::unique_ptr<EpochDomain> _epoch;
+  /// Serializes allocations from _bean_resource in concurrent mode
+  LockingMemoryResource _locked_resource{nullptr};
+  /// Instances of BeanScope::THREAD, shared with the threads that use them
+  std::shared_ptr<ThreadScopeRegistry> _thread_scopes;
+
+  TypeBucket &bucket(std::size_t type);
+  const TypeBucket *findBucket(std::size_t type) const;
+
+  bool addBean(const BeanType &type, void *bean, const BeanOps *ops, std::pmr::memory_resource *resource,
+               std::string_view name, std::unique_ptr<LazyBean> lazy);
+  /**
+   * Builds a lazy bean if needed and returns it, nullptr if it was removed before being built. Must
+   * be called without any lock or pin: lookups take the definition while pinned, then build.
+   */
+  void *resolve(void *bean, const std::shared_ptr<LazyBean> &lazy);
+
+  /// Drops a bean from the implementations of an interface, true if it was the first one
+  bool removeImplementation(std::size_t interfaceType, void *bean);
+  /// Removes a bean from the indexes and returns its entry, must be called with _writer_mutex held
+  std::optional<BeanHolder> unregisterBean(void *bean);
+  /// Publishes a fresh snapshot when in concurrent mode, must be called with _writer_mutex held
+  void publishSnapshot();
+  /// Publishes a fresh snapshot whatever the mode, must be called with _writer_mutex held and _epoch set
+  void replaceSnapshot();
 
 protected:
+  /**
+   * Destroys a single bean through its BeanOps, removing it from the factory.
+   *
+   * \param bean the bean to destroy.
+   * \return true if the bean was known and destroyed.
+   */
+  bool destroyBean(void *bean);
+
+  /**
+   * Creates the generation counter of a type, the first time one is asked for. Factories whose
+   * lookups fall back to another one return a counter they share with it, so that it is bumped by
+   * the changes of both. Called with _writer_mutex held.
+   */
+  virtual std::shared_ptr<std::atomic<std::uint64_t>> makeFirstBeanGeneration(const BeanType &type);
+
+  /// Same counter as firstBeanGeneration, for factories sharing it
+  std::shared_ptr<std::atomic<std::uint64_t>> sharedFirstBeanGeneration(const BeanType &type);
+
+  /**
+   * Destroys the bean pools and the thread scopes, then every bean still registered, newest first,
+   * in a single pass.
+   *
+   * Only the per-type buckets are kept up to date while the beans are destroyed; name and pointer
+   * entries are flagged as destroyed and all the indexes are dropped at once afterwards. Beans can
+   * neither be registered nor destroyed individually while this runs.
+   *
+   * Leaves concurrent mode: no other thread may use the factory anymore.
+   */
+  void destroyBeans();
+
+  std::pmr::memory_resource *beanMemoryResource() override;
+  std::pmr::memory_resource *prototypeMemoryResource() override;
   void deleteBean(void *bean) override;
-  bool registerBean(const BeanType &type, void *bean, deleter_t deleter, std::string &&name) override;
+  bool registerBean(const BeanType &type, void *bean, const BeanOps *ops, std::pmr::memory_resource *resource, std::string_view name) override;
+  bool registerLazyBean(const BeanType &type, void *bean, const BeanOps *ops, std::pmr::memory_resource *resource,
+                        std::string_view name, std::unique_ptr<LazyBean> lazy) override;
   void *getBeanTypeByName(const BeanType &type, std::string_view view) override;
   void *getFirstBeanOfType(const BeanType &type) override;
-  std::string makeDefaultBeanName(const BeanType &type) override;
+  std::vector<void *> getBeansOfType(const BeanType &type) override;
+  const std::atomic<std::uint64_t> &firstBeanGeneration(const BeanType &type) override;
+  void registerBeanInterface(void *bean, const BeanType &interfaceType, AdjustToInterface adjust) override;
+  BeanPoolBase *findBeanPool(const BeanType &type) override;
+  BeanPoolBase &addBeanPool(const BeanType &type, std::unique_ptr<BeanPoolBase> pool) override;
+  ScopedBeans &threadScopedBeans() override;
+  std::string_view makeDefaultBeanName(const BeanType &type) override;
 
 public:
-  ~DefaultBeanFactoryImpl() override = default;
+  explicit DefaultBeanFactoryImpl(std::pmr::memory_resource *resource = std::pmr::get_default_resource());
+  ~DefaultBeanFactoryImpl() override;
+
+  /**
+   * Changes the resource used to allocate beans created from now on.
+   * Beans already created keep being released through the resource they came from.
+   */
+  void setBeanMemoryResource(std::pmr::memory_resource *resource);
+
+  /**
+   * Changes the resource getNewInstance allocates from. It is used without locking, so it must be
+   * thread safe if concurrent access is enabled. Instances already created keep being released
+   * through the resource they came from.
+   */
+  void setPrototypeMemoryResource(std::pmr::memory_resource *resource);
+
+  /**
+   * Builds every bean defined through defineBean and not built yet, following their dependencies.
+   *
+   * Once concurrent access is enabled, beans whose dependencies are built are constructed
+   * concurrently on a work-stealing pool; before that, they are all built on the calling thread.
+   * Nothing is built when the dependencies form a cycle. If a factory throws, the beans depending on
+   * it are skipped and the first exception is rethrown once the others are done.
+   *
+   * \param threads maximum number of threads to build beans on in concurrent mode; 1 builds them on
+   *                the calling thread.
+   * \return what was built and the critical path of the initialization.
+   */
+  BeanInitializationReport initializeEagerBeans(std::size_t threads);
+
+  /**
+   * Switches the factory to concurrent mode: from now on lookups may run on any thread while
+   * other threads register or delete beans, and never block. Cannot be undone.
+   */
+  void enableConcurrentAccess();
 
   bool isBeanKnown(void *beanPtr) const override;
   BeanNameT beanName(void *beanPtr) const override;
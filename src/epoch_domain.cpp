@@ -0,0 +1,41 @@
+
+#include "epoch_domain.h"
+
+#include <thread>
+
+namespace framework::impl {
+std::size_t EpochDomain::threadStripe() noexcept {
+  // Handed out round robin, thread ids are too regularly spaced to spread well by hashing
+  static std::atomic<std::size_t> nextStripe{0};
+  thread_local const std::size_t stripe = nextStripe.fetch_add(1, std::memory_order_relaxed) % STRIPES;
+  return stripe;
+}
+
+EpochDomain::Guard EpochDomain::pin() noexcept {
+  auto &stripe = _stripes[threadStripe()];
+
+  for (;;) {
+    const auto epoch = _epoch.load(std::memory_order_seq_cst);
+    auto &readers = stripe.readers[epoch & 1];
+    readers.fetch_add(1, std::memory_order_seq_cst);
+
+    // The writer did not switch epochs in between, it will wait for us
+    if (_epoch.load(std::memory_order_seq_cst) == epoch) {
+      return Guard{&readers};
+    }
+
+    readers.fetch_sub(1, std::memory_order_release);
+  }
+}
+
+void EpochDomain::synchronize() noexcept {
+  // New readers go to the other side, wait for the ones already in
+  const auto epoch = _epoch.fetch_add(1, std::memory_order_seq_cst);
+
+  for (auto &stripe: _stripes) {
+    while (stripe.readers[epoch & 1].load(std::memory_order_acquire) != 0) {
+      std::this_thread::yield();
+    }
+  }
+}
+}// namespace framework::impl
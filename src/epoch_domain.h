@@ -0,0 +1,59 @@
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace framework::impl {
+
+/**
+ * Class EpochDomain
+ *
+ * Minimal epoch-based reclamation for read-mostly data published through an atomic pointer.
+ *
+ * Readers pin the current epoch for the duration of a lookup; pinning never waits on writers, it
+ * only bumps a reader counter on a per-thread stripe. Writers, which must be serialized by the
+ * caller, publish the new data then call synchronize(): it advances the epoch and waits until no
+ * reader pinned before the switch is still running, after which the previous data can be freed.
+ */
+class EpochDomain {
+  static constexpr std::size_t STRIPES = 64;
+
+  struct alignas(64) Stripe {
+    std::array<std::atomic<std::int64_t>, 2> readers{};
+  };
+
+  std::atomic<std::uint64_t> _epoch{0};
+  std::array<Stripe, STRIPES> _stripes{};
+
+  static std::size_t threadStripe() noexcept;
+
+public:
+  /**
+   * Keeps the epoch pinned while alive, anything loaded from the published pointer stays valid.
+   */
+  class Guard {
+    std::atomic<std::int64_t> *_readers;
+
+  public:
+    explicit Guard(std::atomic<std::int64_t> *readers) : _readers(readers) {}
+    Guard(const Guard &) = delete;
+    Guard &operator=(const Guard &) = delete;
+    ~Guard() { _readers->fetch_sub(1, std::memory_order_release); }
+  };
+
+  /**
+   * Pins the current epoch. Lock-free: only retries if a writer advanced the epoch meanwhile.
+   */
+  [[nodiscard]] Guard pin() noexcept;
+
+  /**
+   * Waits until every reader that may still see data published before this call is done.
+   * Writers must not call this concurrently with each other.
+   */
+  void synchronize() noexcept;
+};
+
+}// namespace framework::impl
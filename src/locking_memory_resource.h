@@ -0,0 +1,39 @@
+
+#pragma once
+
+#include <memory_resource>
+#include <mutex>
+
+namespace framework::impl {
+
+/**
+ * Class LockingMemoryResource
+ *
+ * Serializes access to an upstream memory resource that is not thread-safe, like a monotonic
+ * arena, without changing where the memory comes from.
+ */
+class LockingMemoryResource : public std::pmr::memory_resource {
+  std::pmr::memory_resource *_upstream;
+  std::mutex _mutex;
+
+protected:
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    const std::lock_guard lock(_mutex);
+    return _upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+    const std::lock_guard lock(_mutex);
+    _upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+public:
+  explicit LockingMemoryResource(std::pmr::memory_resource *upstream) : _upstream(upstream) {}
+
+  std::pmr::memory_resource *upstream() const { return _upstream; }
+  void setUpstream(std::pmr::memory_resource *upstream) { _upstream = upstream; }
+};
+
+}// namespace framework::impl
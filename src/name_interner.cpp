@@ -0,0 +1,24 @@
+
+#include "name_interner.h"
+
+namespace framework::impl {
+const NameInterner::InternedName *NameInterner::intern(std::string_view name) {
+  const auto key = makeKey(name);
+  if (const auto it = _names.find(key); it != _names.end()) {
+    return &*it;
+  }
+
+  return &*_names.emplace(std::string(name), key.hash).first;
+}
+
+const NameInterner::InternedName *NameInterner::find(std::string_view name) const {
+  const auto it = _names.find(makeKey(name));
+  return it != _names.end() ? &*it : nullptr;
+}
+
+void NameInterner::erase(const InternedName *name) {
+  if (const auto it = _names.find(Key{name->name, name->hash}); it != _names.end()) {
+    _names.erase(it);
+  }
+}
+}// namespace framework::impl
@@ -0,0 +1,88 @@
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+namespace framework::impl {
+
+/**
+ * Class NameInterner
+ *
+ * Stores each distinct name once, along with its precomputed hash. Interned names have stable
+ * addresses until they are erased, so containers can key on the InternedName pointer: hashing
+ * reuses the stored hash and equality is a pointer comparison.
+ */
+class NameInterner {
+public:
+  struct InternedName {
+    std::string name;
+    std::size_t hash;
+  };
+
+  /// Hasher for maps keyed on interned names, reuses the precomputed hash
+  struct Hash {
+    std::size_t operator()(const InternedName *name) const noexcept { return name->hash; }
+  };
+
+  /**
+   * Returns the interned copy of a name, interning it first if needed.
+   *
+   * \param name the name to intern.
+   * \return the interned name; stable until erased.
+   */
+  const InternedName *intern(std::string_view name);
+
+  /**
+   * Looks up a name without interning it.
+   *
+   * \param name the name to look for.
+   * \return the interned name, or nullptr if the name was never interned.
+   */
+  const InternedName *find(std::string_view name) const;
+
+  /**
+   * Forgets an interned name. The pointer must not be used afterwards.
+   */
+  void erase(const InternedName *name);
+
+  /**
+   * Forgets every interned name.
+   */
+  void clear() { _names.clear(); }
+
+  std::size_t size() const { return _names.size(); }
+
+private:
+  struct Key {
+    std::string_view name;
+    std::size_t hash;
+  };
+
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(const InternedName &name) const noexcept { return name.hash; }
+    std::size_t operator()(const Key &key) const noexcept { return key.hash; }
+  };
+
+  struct NameEqual {
+    using is_transparent = void;
+    bool operator()(const InternedName &lhs, const InternedName &rhs) const noexcept {
+      return lhs.hash == rhs.hash && lhs.name == rhs.name;
+    }
+    bool operator()(const Key &lhs, const InternedName &rhs) const noexcept {
+      return lhs.hash == rhs.hash && lhs.name == rhs.name;
+    }
+    bool operator()(const InternedName &lhs, const Key &rhs) const noexcept {
+      return lhs.hash == rhs.hash && lhs.name == rhs.name;
+    }
+  };
+
+  static Key makeKey(std::string_view name) noexcept { return {name, std::hash<std::string_view>{}(name)}; }
+
+  std::unordered_set<InternedName, NameHash, NameEqual> _names;
+};
+
+}// namespace framework::impl
@@ -0,0 +1,225 @@
+
+#include "property_change_dispatcher.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <utility>
+
+namespace framework::impl {
+
+std::size_t PropertyChangeDispatcher::addWatcher(const void *owner, std::string_view key, bool prefix, Callback callback) {
+  const std::lock_guard lock(_mutex);
+  if (_stopping) {
+    return 0;
+  }
+
+  auto watcher = std::make_shared<Watcher>(Watcher{_next_id++, owner, std::string(key), prefix, std::move(callback)});
+  auto &index = prefix ? _by_prefix : _by_name;
+  auto it = index.find(key);
+  if (it == index.end()) {
+    it = index.try_emplace(watcher->key).first;
+  }
+  it->second.push_back(watcher);
+  if (prefix) {
+    _prefix_lengths[key.size()]++;
+  }
+
+  _watchers.emplace(watcher->id, watcher);
+  _watched.store(true, std::memory_order_release);
+
+  if (!_thread.joinable()) {
+    _thread = std::thread([this] { run(); });
+  }
+  return watcher->id;
+}
+
+void PropertyChangeDispatcher::removeWatcher(std::size_t id) {
+  {
+    const std::lock_guard lock(_mutex);
+    const auto found = _watchers.find(id);
+    if (found == _watchers.end()) {
+      return;
+    }
+
+    unindex(*found->second);
+    _watchers.erase(found);
+    _watched.store(!_watchers.empty(), std::memory_order_release);
+  }
+  waitForCallbacks();
+}
+
+void PropertyChangeDispatcher::removeWatchers(const void *owner) {
+  {
+    const std::lock_guard lock(_mutex);
+    std::erase_if(_watchers, [this, owner](const auto &entry) {
+      if (entry.second->owner != owner) {
+        return false;
+      }
+      unindex(*entry.second);
+      return true;
+    });
+    _watched.store(!_watchers.empty(), std::memory_order_release);
+    _pending.erase(owner);
+    _all_pending.erase(owner);
+  }
+  waitForCallbacks();
+}
+
+void PropertyChangeDispatcher::unindex(const Watcher &watcher) {
+  auto &index = watcher.prefix ? _by_prefix : _by_name;
+  if (const auto it = index.find(watcher.key); it != index.end()) {
+    std::erase_if(it->second, [&watcher](const auto &indexed) { return indexed.get() == &watcher; });
+    if (it->second.empty()) {
+      index.erase(it);
+    }
+  }
+  if (watcher.prefix && --_prefix_lengths[watcher.key.size()] == 0) {
+    _prefix_lengths.erase(watcher.key.size());
+  }
+}
+
+void PropertyChangeDispatcher::waitForCallbacks() {
+  // A batch matched before the removal may still be running the callback
+  if (std::this_thread::get_id() != _thread.get_id()) {
+    const std::lock_guard delivering(_delivering);
+  }
+}
+
+void PropertyChangeDispatcher::propertyChanged(const void *owner, std::string_view propertyName) {
+  if (!_watched.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  {
+    const std::lock_guard lock(_mutex);
+    if (_stopping) {
+      return;
+    }
+    auto &pending = _pending[owner];
+    if (pending.contains(propertyName)) {
+      return;
+    }
+    pending.emplace(propertyName);
+  }
+  _changed.notify_one();
+}
+
+void PropertyChangeDispatcher::allPropertiesChanged(const void *owner) {
+  if (!_watched.load(std::memory_order_acquire)) {
+    return;
+  }
+
+  {
+    const std::lock_guard lock(_mutex);
+    if (_stopping) {
+      return;
+    }
+    _all_pending.insert(owner);
+  }
+  _changed.notify_one();
+}
+
+void PropertyChangeDispatcher::flush() {
+  std::unique_lock lock(_mutex);
+  _idle.wait(lock, [this] {
+    return !_thread.joinable() || (_pending.empty() && _all_pending.empty() && !_dispatching);
+  });
+}
+
+PropertyChangeDispatcher::~PropertyChangeDispatcher() {
+  // The thread would run on freed state once the callback returns, and a joinable std::thread
+  // cannot be destroyed either: fail right away rather than later and elsewhere
+  if (_thread.joinable() && std::this_thread::get_id() == _thread.get_id()) {
+    std::abort();
+  }
+  stop();
+}
+
+void PropertyChangeDispatcher::stop() {
+  {
+    const std::lock_guard lock(_mutex);
+    _stopping = true;
+  }
+  _changed.notify_one();
+
+  if (_thread.joinable() && std::this_thread::get_id() != _thread.get_id()) {
+    _thread.join();
+  }
+}
+
+void PropertyChangeDispatcher::run() {
+  std::unique_lock lock(_mutex);
+  while (true) {
+    _changed.wait(lock, [this] { return _stopping || !_all_pending.empty() || !_pending.empty(); });
+    if (_pending.empty() && _all_pending.empty()) {
+      break;
+    }
+
+    // Everything queued so far goes in a single batch
+    auto batch = std::exchange(_pending, {});
+    auto all = std::exchange(_all_pending, {});
+    _dispatching = true;
+
+    lock.unlock();
+    deliver(std::move(batch), std::move(all));
+    lock.lock();
+
+    _dispatching = false;
+    if (_pending.empty() && _all_pending.empty()) {
+      _idle.notify_all();
+    }
+  }
+}
+
+void PropertyChangeDispatcher::deliver(std::unordered_map<const void *, NameSet> batch, std::unordered_set<const void *> all) {
+  // Taken before matching, so a watcher removed meanwhile is either matched and waited for, or skipped
+  const std::lock_guard delivering(_delivering);
+
+  std::vector<std::pair<std::shared_ptr<Watcher>, std::vector<std::string>>> calls;
+  {
+    const std::lock_guard lock(_mutex);
+    // Any property of these owners may have changed, each of their watchers gets an empty batch
+    for (const auto &[id, watcher]: _watchers) {
+      if (all.contains(watcher->owner)) {
+        calls.emplace_back(watcher, std::vector<std::string>{});
+      }
+    }
+
+    std::unordered_map<const Watcher *, std::size_t> slots;
+    const auto match = [&calls, &slots](const WatcherIndex &index, const void *owner, std::string_view key,
+                                        const std::string &propertyName) {
+      if (const auto it = index.find(key); it != index.end()) {
+        for (const auto &watcher: it->second) {
+          if (watcher->owner == owner) {
+            const auto [slot, added] = slots.try_emplace(watcher.get(), calls.size());
+            if (added) {
+              calls.emplace_back(watcher, std::vector<std::string>{});
+            }
+            calls[slot->second].second.push_back(propertyName);
+          }
+        }
+      }
+    };
+
+    for (const auto &[owner, propertyNames]: batch) {
+      if (all.contains(owner)) {
+        continue;
+      }
+      for (const auto &propertyName: propertyNames) {
+        match(_by_name, owner, propertyName, propertyName);
+        for (const auto &[length, count]: _prefix_lengths) {
+          if (length > propertyName.size()) {
+            break;
+          }
+          match(_by_prefix, owner, std::string_view(propertyName).substr(0, length), propertyName);
+        }
+      }
+    }
+  }
+
+  for (const auto &[watcher, propertyNames]: calls) {
+    watcher->callback(propertyNames);
+  }
+}
+
+}// namespace framework::impl
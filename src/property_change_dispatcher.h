@@ -0,0 +1,130 @@
+
+#pragma once
+
+#include "sproutpp/property_resolver.h"
+#include "string_hash.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace framework::impl {
+
+/**
+ * Class PropertyChangeDispatcher
+ *
+ * Delivers property changes to watchers on a thread of its own, started with the first watcher.
+ * Changing threads only add the name to the pending batch; the dispatcher thread takes the whole
+ * batch at once, so names changed again meanwhile are delivered once.
+ *
+ * Watchers are indexed by exact name and by prefix. A changed name is matched with one probe of
+ * the exact index plus one probe of the prefix index per distinct prefix length, so a change only
+ * wakes the watchers that care whatever their number.
+ *
+ * Several resolvers may share one dispatcher, and so one thread: each watcher and each change
+ * belongs to an owner, the resolver it was registered with, and a change only reaches the watchers
+ * of its owner. removeWatchers drops the watchers of an owner going away.
+ *
+ * The dispatcher must not be destroyed from one of its callbacks: the thread delivering them still
+ * runs on its state once they return.
+ */
+class PropertyChangeDispatcher {
+  using Callback = PropertyResolver::PropertiesChangedCallback;
+
+  struct Watcher {
+    std::size_t id;
+    const void *owner;
+    std::string key;
+    bool prefix;
+    Callback callback;
+  };
+
+  using NameSet = std::unordered_set<std::string, StringHash, std::equal_to<>>;
+  using WatcherIndex = std::unordered_map<std::string, std::vector<std::shared_ptr<Watcher>>, StringHash, std::equal_to<>>;
+
+  /// Guards everything below but _delivering
+  std::mutex _mutex;
+  /// Signals the dispatcher thread that there is work, and flush() that it is done
+  std::condition_variable _changed;
+  std::condition_variable _idle;
+
+  std::unordered_map<std::size_t, std::shared_ptr<Watcher>> _watchers;
+  WatcherIndex _by_name;
+  WatcherIndex _by_prefix;
+  /// Number of prefixes of each length
+  std::map<std::size_t, std::size_t> _prefix_lengths;
+  std::size_t _next_id = 1;
+  /// Lets changes skip the lock while nobody watches
+  std::atomic<bool> _watched{false};
+
+  /// Changed names by owner, and the owners any of whose properties may have changed
+  std::unordered_map<const void *, NameSet> _pending;
+  std::unordered_set<const void *> _all_pending;
+  bool _dispatching = false;
+  bool _stopping = false;
+  std::thread _thread;
+
+  /// Held while callbacks run, so removeWatcher can wait for them
+  std::mutex _delivering;
+
+  void run();
+  void deliver(std::unordered_map<const void *, NameSet> batch, std::unordered_set<const void *> all);
+  /// Drops a watcher from the indexes; _mutex must be held
+  void unindex(const Watcher &watcher);
+  /// Waits for the callbacks running, unless called from one of them
+  void waitForCallbacks();
+
+public:
+  PropertyChangeDispatcher() = default;
+  PropertyChangeDispatcher(const PropertyChangeDispatcher &) = delete;
+  PropertyChangeDispatcher &operator=(const PropertyChangeDispatcher &) = delete;
+  /// Stops the dispatcher; aborts when called from the dispatcher thread, which cannot join itself
+  ~PropertyChangeDispatcher();
+
+  /**
+   * Adds a watcher of the changes of owner, starting the dispatcher thread if needed.
+   *
+   * \return an identifier for removeWatcher.
+   */
+  std::size_t addWatcher(const void *owner, std::string_view key, bool prefix, Callback callback);
+
+  /**
+   * Removes a watcher; waits for its callback to return unless called from the dispatcher thread.
+   */
+  void removeWatcher(std::size_t id);
+
+  /**
+   * Removes every watcher of owner, and the changes still pending for it; waits for the callbacks
+   * running unless called from the dispatcher thread.
+   */
+  void removeWatchers(const void *owner);
+
+  /// Queues a changed property of owner
+  void propertyChanged(const void *owner, std::string_view propertyName);
+
+  /// Queues a change of any property of owner
+  void allPropertiesChanged(const void *owner);
+
+  /**
+   * Waits until every change queued so far has been delivered. Must not be called from a callback.
+   */
+  void flush();
+
+  /**
+   * Delivers the pending changes then stops the dispatcher thread; nothing is delivered afterwards.
+   * Called from a callback, the thread exits once the callbacks return and is joined by the
+   * destructor.
+   */
+  void stop();
+};
+
+}// namespace framework::impl
@@ -1,10 +1,15 @@
 
 #include "environment_property_source.h"
 
+#include <algorithm>
+#include <cctype>
 #include <cstdlib>
+#include <mutex>
 #ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
+#else
+extern "C" char **environ;
 #endif
 
 namespace {
@@ -27,10 +32,138 @@ std::string makeName(std::string_view name) {
 
   return result;
 }
+
+/// Canonical form of a name character, '-' has none and is skipped
+char canonicalChar(char c) {
+  if (c == '_') {
+    return '.';
+  }
+  return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+std::string canonicalName(std::string_view name) {
+  std::string result;
+  result.reserve(name.size());
+  for (const auto c: name) {
+    if (c != '-') {
+      result += canonicalChar(c);
+    }
+  }
+  return result;
+}
+
+/// Whether some property name maps to this variable
+bool isPropertyVariable(std::string_view name) {
+  return !name.empty() && std::ranges::none_of(name, [](char c) {
+    return c == '.' || c == '-' || std::islower(static_cast<unsigned char>(c));
+  });
+}
 }// namespace
 
 namespace framework::impl {
+std::size_t EnvironmentPropertySource::CanonicalHash::operator()(std::string_view name) const noexcept {
+  // FNV-1a over the canonical characters
+  std::size_t result;
+  if constexpr (sizeof(std::size_t) == 8) {
+    result = 0xcbf29ce484222325;
+  } else {
+    result = 0x811c9dc5;
+  }
+
+  for (const auto c: name) {
+    if (c != '-') {
+      result ^= static_cast<unsigned char>(canonicalChar(c));
+      if constexpr (sizeof(std::size_t) == 8) {
+        result *= 0x100000001b3;
+      } else {
+        result *= 0x01000193;
+      }
+    }
+  }
+  return result;
+}
+
+bool EnvironmentPropertySource::CanonicalEqual::operator()(std::string_view lhs, std::string_view rhs) const noexcept {
+  std::size_t i = 0;
+  std::size_t j = 0;
+  while (true) {
+    while (i < lhs.size() && lhs[i] == '-') {
+      ++i;
+    }
+    while (j < rhs.size() && rhs[j] == '-') {
+      ++j;
+    }
+    if (i == lhs.size() || j == rhs.size()) {
+      return i == lhs.size() && j == rhs.size();
+    }
+    if (canonicalChar(lhs[i++]) != canonicalChar(rhs[j++])) {
+      return false;
+    }
+  }
+}
+
+EnvironmentPropertySource::EnvironmentPropertySource(Mode mode, std::string_view prefix)
+    : _mode(mode), _prefix(canonicalName(prefix)) {
+  if (_mode == Mode::SNAPSHOT) {
+    _variables = readEnvironment();
+  }
+}
+
+EnvironmentPropertySource::Variables EnvironmentPropertySource::readEnvironment() const {
+  Variables variables;
+  const auto add = [this, &variables](std::string_view variable) {
+    const auto equal = variable.find('=');
+    if (equal == std::string_view::npos || !isPropertyVariable(variable.substr(0, equal))) {
+      return;
+    }
+    if (auto name = canonicalName(variable.substr(0, equal)); name.starts_with(_prefix)) {
+      variables.insert_or_assign(std::move(name), std::string(variable.substr(equal + 1)));
+    }
+  };
+
+#ifdef _WIN32
+  if (const auto block = GetEnvironmentStringsA()) {
+    // NAME=value strings one after the other, the last one followed by an empty one
+    for (auto variable = block; *variable != '\0'; variable += std::char_traits<char>::length(variable) + 1) {
+      add(variable);
+    }
+    FreeEnvironmentStringsA(block);
+  }
+#else
+  for (auto variable = environ; variable != nullptr && *variable != nullptr; ++variable) {
+    add(*variable);
+  }
+#endif
+
+  return variables;
+}
+
+void EnvironmentPropertySource::refresh() {
+  if (_mode != Mode::SNAPSHOT) {
+    return;
+  }
+
+  auto variables = readEnvironment();
+  bool changed;
+  {
+    const std::unique_lock lock(_mutex);
+    changed = variables != _variables;
+    std::swap(_variables, variables);
+  }
+
+  // Watchers may have looked a variable up under any spelling of its name, they cannot be told
+  // which ones changed; notified outside the lock, they read the new values back
+  if (changed) {
+    notifyAllValuesChanged();
+  }
+}
+
 bool EnvironmentPropertySource::containsProperty(std::string_view propertyName) const {
+  if (_mode == Mode::SNAPSHOT) {
+    const std::shared_lock lock(_mutex);
+    return _variables.contains(propertyName);
+  }
+
   const auto name = makeName(propertyName);
 #ifdef _WIN32
   size_t requiredSize;
@@ -42,6 +175,14 @@ bool EnvironmentPropertySource::containsProperty(std::string_view propertyName)
 }
 
 PropertySource::Value EnvironmentPropertySource::getProperty(std::string_view propertyName) const {
+  if (_mode == Mode::SNAPSHOT) {
+    const std::shared_lock lock(_mutex);
+    if (const auto it = _variables.find(propertyName); it != _variables.end()) {
+      return it->second;
+    }
+    return std::monostate{};
+  }
+
   const auto name = makeName(propertyName);
 
 #ifdef _WIN32
@@ -3,19 +3,80 @@
 
 #include "sproutpp/property_source.h"
 
+#include <cstddef>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
 namespace framework::impl {
 
 /**
  * Class EnvironmentPropertySource
+ *
+ * A property maps to the environment variable named after it uppercased, with '.' replaced by '_'
+ * and '-' dropped: "app.db-host" reads APP_DBHOST.
+ *
+ * By default every lookup reads the environment. Such a live source never reports changes, so a
+ * resolver caching its values does not see a variable set afterwards. In snapshot mode the variables are copied once,
+ * at construction, into a table keyed by their canonical dotted lowercase name ("app.dbhost"), and
+ * only read again by refresh(). Lookups then neither allocate nor scan the environment, and may run
+ * on several threads, even while another one refreshes. Variables no property name maps to, those
+ * with a lowercase letter, '.' or '-' in their name, are left out of the table.
  */
 class EnvironmentPropertySource : public PropertySource {
+public:
+  enum class Mode {
+    /// Every lookup calls getenv
+    LIVE,
+    /// Lookups read a copy of the environment, see refresh()
+    SNAPSHOT,
+  };
+
+private:
+  /// Hashes and compares names as their canonical form, so any spelling of a name finds its entry
+  struct CanonicalHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const noexcept;
+  };
+
+  struct CanonicalEqual {
+    using is_transparent = void;
+    bool operator()(std::string_view lhs, std::string_view rhs) const noexcept;
+  };
+
+  using Variables = std::unordered_map<std::string, std::string, CanonicalHash, CanonicalEqual>;
+
+  Mode _mode = Mode::LIVE;
+  /// Canonical prefix of the variables kept in the snapshot
+  std::string _prefix;
+  Variables _variables;
+  mutable std::shared_mutex _mutex;
+
+  /// Copies the environment variables matching the prefix
+  Variables readEnvironment() const;
+
 public:
   EnvironmentPropertySource() = default;
+
+  /**
+   * \param mode whether lookups read the environment or a copy of it.
+   * \param prefix in snapshot mode, only the variables whose canonical name starts with the canonical
+   *               form of this prefix are kept: "app." (or "APP_") keeps APP_DB_HOST but not PATH.
+   */
+  explicit EnvironmentPropertySource(Mode mode, std::string_view prefix = {});
   ~EnvironmentPropertySource() override = default;
 
   bool containsProperty(std::string_view propertyName) const override;
   Value getProperty(std::string_view propertyName) const override;
   bool hasValues() const override { return true; }
+
+  /**
+   * Reads the environment again in snapshot mode then, if any variable was added, removed or changed
+   * since, notifies the watchers that any property may have changed: a resolver drops every value it
+   * cached, under whatever spelling it was looked up. Does nothing in live mode.
+   */
+  void refresh();
 };
 
 }// namespace framework::impl
@@ -0,0 +1,25 @@
+#pragma once
+#include "map_property_source.h"
+
+namespace framework::impl {
+/**
+ * Class FlatPropertySource
+ *
+ * Static layers merged into a single table, so a lookup costs one probe however many layers
+ * it replaces. Layers are added lowest precedence first.
+ */
+class FlatPropertySource : public MapPropertySource {
+public:
+  ~FlatPropertySource() override = default;
+
+  bool isStatic() const override { return true; }
+
+  /**
+   * Adds a layer on top of the ones already merged.
+   *
+   * @param layer the source to merge, its values win over the previous layers
+   */
+  void addLayer(const MapPropertySource &layer) { mergeProperties(layer); }
+};
+
+}// namespace framework::impl
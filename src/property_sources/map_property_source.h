@@ -1,7 +1,9 @@
 
 #pragma once
-#include <map>
+#include <mutex>
 #include <ranges>
+#include <shared_mutex>
+#include <unordered_map>
 
 #include "sproutpp/property_source.h"
 
@@ -9,10 +11,20 @@ namespace framework::impl {
 
 /**
  * Class MapPropertySource
+ *
+ * Values may be set while other threads read them; watchers are notified after the change,
+ * outside the lock.
  */
 class MapPropertySource : public PropertySource {
   using Key = decltype(std::hash<std::string_view>{}(""));// should be size_t
-  std::map<Key, Value> _properties;
+
+  /// Keys already are hashes
+  struct KeyHash {
+    std::size_t operator()(Key key) const noexcept { return key; }
+  };
+
+  std::unordered_map<Key, Value, KeyHash> _properties;
+  mutable std::shared_mutex _mutex;
 
   /**
    * FNV-1a 32/64bit algorithm
@@ -44,33 +56,60 @@ class MapPropertySource : public PropertySource {
     return result;
   }
 
+protected:
+  /**
+   * Copies every property of another source, replacing the values of the names both define.
+   * Watchers are not notified.
+   *
+   * @param other the source to copy
+   */
+  void mergeProperties(const MapPropertySource &other) {
+    const std::shared_lock otherLock(other._mutex);
+    const std::unique_lock lock(_mutex);
+    _properties.reserve(_properties.size() + other._properties.size());
+    for (const auto &[key, value]: other._properties) {
+      _properties.insert_or_assign(key, value);
+    }
+  }
+
 public:
   ~MapPropertySource() override = default;
 
-  bool hasValues() const override { return !_properties.empty(); }
+  bool hasValues() const override {
+    const std::shared_lock lock(_mutex);
+    return !_properties.empty();
+  }
 
   bool isStatic() const override { return false; }
 
   bool containsProperty(std::string_view propertyName) const override {
+    const std::shared_lock lock(_mutex);
     return _properties.contains(geyKey(propertyName));
   }
 
   Value getProperty(std::string_view propertyName) const override {
-    const auto key = geyKey(propertyName);
-    if (!_properties.contains(key)) {
-      return std::monostate{};
+    const std::shared_lock lock(_mutex);
+    if (const auto it = _properties.find(geyKey(propertyName)); it != _properties.end()) {
+      return it->second;
     }
-    return _properties.at(key);
+    return std::monostate{};
   }
 
   void setProperty(std::string_view propertyName, const Value &value) {
-    _properties.erase(geyKey(propertyName));
-    _properties.try_emplace(geyKey(propertyName), value);
+    {
+      const std::unique_lock lock(_mutex);
+      _properties.insert_or_assign(geyKey(propertyName), value);
+    }
     notifyValueChanged(propertyName);
   }
 
   void removeProperty(std::string_view propertyName) {
-    if (_properties.erase(geyKey(propertyName)) == 1) {
+    std::size_t removed;
+    {
+      const std::unique_lock lock(_mutex);
+      removed = _properties.erase(geyKey(propertyName));
+    }
+    if (removed == 1) {
       notifyValueChanged(propertyName);
     }
   }
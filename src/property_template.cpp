@@ -0,0 +1,75 @@
+
+#include "property_template.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+namespace framework::impl {
+
+std::shared_ptr<const PropertyTemplate> PropertyTemplate::compile(std::string_view value) {
+  auto compiled = std::make_shared<PropertyTemplate>();
+  std::string literal;
+
+  while (!value.empty()) {
+    const auto start = value.find("${");
+    const auto end = start == std::string_view::npos ? std::string_view::npos : value.find('}', start + 2);
+    // No complete placeholder left, or an empty key: the rest is literal text
+    if (end == std::string_view::npos) {
+      literal += value;
+      break;
+    }
+
+    const auto placeholder = value.substr(start + 2, end - start - 2);
+    const auto colon = placeholder.find(':');
+    const auto key = placeholder.substr(0, colon);
+    if (key.empty()) {
+      literal += value.substr(0, end + 1);
+      value.remove_prefix(end + 1);
+      continue;
+    }
+
+    literal += value.substr(0, start);
+    if (!literal.empty()) {
+      compiled->_parts.push_back({std::move(literal), {}, false, false});
+      literal.clear();
+    }
+
+    Part reference{std::string(key), {}, true, colon != std::string_view::npos};
+    if (reference.hasDefault) {
+      reference.defaultValue = placeholder.substr(colon + 1);
+    }
+    if (std::ranges::find(compiled->_references, key) == compiled->_references.end()) {
+      compiled->_references.emplace_back(key);
+    }
+    compiled->_parts.push_back(std::move(reference));
+    value.remove_prefix(end + 1);
+  }
+
+  if (compiled->_references.empty()) {
+    return nullptr;
+  }
+  if (!literal.empty()) {
+    compiled->_parts.push_back({std::move(literal), {}, false, false});
+  }
+  return compiled;
+}
+
+void PropertyTemplate::append(std::string &result, const PropertySource::Value &value) {
+  std::visit(
+      [&result](const auto &alternative) {
+        using T = std::decay_t<decltype(alternative)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+          result += alternative;
+        } else if constexpr (std::is_same_v<T, bool>) {
+          result += alternative ? "true" : "false";
+        } else if constexpr (std::is_arithmetic_v<T>) {
+          std::array<char, 32> buffer{};
+          const auto [end, ec] = std::to_chars(buffer.data(), buffer.data() + buffer.size(), alternative);
+          result.append(buffer.data(), end);
+        }
+      },
+      value);
+}
+
+}// namespace framework::impl
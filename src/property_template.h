@@ -0,0 +1,77 @@
+
+#pragma once
+
+#include "sproutpp/property_source.h"
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace framework::impl {
+
+/**
+ * Class PropertyTemplate
+ *
+ * A property value holding ${key} or ${key:default} placeholders, split once into literal text and
+ * references so that expanding it again only costs the lookups. A placeholder whose key does not
+ * resolve expands to its default, or is kept as written when it has none. Placeholders do not nest,
+ * a default is literal text up to the first '}'.
+ */
+class PropertyTemplate {
+  struct Part {
+    /// Literal text, or the key of a reference
+    std::string text;
+    /// Default value of a reference
+    std::string defaultValue;
+    bool reference = false;
+    bool hasDefault = false;
+  };
+
+  std::vector<Part> _parts;
+  /// Distinct keys referenced, in order of appearance
+  std::vector<std::string> _references;
+
+  /// Appends a resolved value in its string form
+  static void append(std::string &result, const PropertySource::Value &value);
+
+public:
+  /**
+   * Compiles a value.
+   *
+   * \return the template, nullptr when the value holds no placeholder.
+   */
+  static std::shared_ptr<const PropertyTemplate> compile(std::string_view value);
+
+  /**
+   * \return the distinct keys the template refers to.
+   */
+  const std::vector<std::string> &references() const { return _references; }
+
+  /**
+   * Expands the placeholders.
+   *
+   * \param lookup called with each key referenced, returns the value it resolves to or nullptr when
+   *               it cannot be resolved; an std::monostate value counts as unresolved too.
+   * \return the expanded value.
+   */
+  template<typename Lookup>
+  std::string expand(Lookup &&lookup) const {
+    std::string result;
+    for (const auto &part: _parts) {
+      if (!part.reference) {
+        result += part.text;
+      } else if (const PropertySource::Value *value = lookup(std::string_view(part.text));
+                 value != nullptr && !std::holds_alternative<std::monostate>(*value)) {
+        append(result, *value);
+      } else if (part.hasDefault) {
+        result += part.defaultValue;
+      } else {
+        result.append("${").append(part.text).append("}");
+      }
+    }
+    return result;
+  }
+};
+
+}// namespace framework::impl
@@ -0,0 +1,19 @@
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string_view>
+
+namespace framework::impl {
+
+/**
+ * Transparent hasher for containers keyed by std::string or std::string_view, so lookups with a
+ * std::string_view need no std::string. Use along with std::equal_to<>.
+ */
+struct StringHash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view str) const noexcept { return std::hash<std::string_view>{}(str); }
+};
+
+}// namespace framework::impl
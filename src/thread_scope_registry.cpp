@@ -0,0 +1,70 @@
+
+#include "thread_scope_registry.h"
+
+#include <algorithm>
+
+namespace framework::impl {
+
+/// Scopes of the calling thread, one per factory it used
+struct ThreadScopeCache {
+  struct Entry {
+    /// Does not keep the registry alive, the factory may go away before the thread
+    std::weak_ptr<ThreadScopeRegistry> registry;
+    ScopedBeans *beans;
+  };
+
+  std::vector<Entry> entries;
+
+  ~ThreadScopeCache() {
+    for (const auto &entry: entries) {
+      if (const auto registry = entry.registry.lock()) {
+        registry->threadExited(entry.beans);
+      }
+    }
+  }
+};
+
+namespace {
+thread_local ThreadScopeCache t_cache;
+}// namespace
+
+ScopedBeans &ThreadScopeRegistry::beansOfThisThread(const std::shared_ptr<ThreadScopeRegistry> &registry) {
+  // Threads rarely use more than one factory. A weak_ptr keeps the control block of its registry,
+  // so an expired entry never matches a registry created since
+  for (const auto &entry: t_cache.entries) {
+    if (!entry.registry.owner_before(registry) && !registry.owner_before(entry.registry)) {
+      return *entry.beans;
+    }
+  }
+
+  // Factories gone since this thread used them, their scopes were destroyed when they closed
+  std::erase_if(t_cache.entries, [](const ThreadScopeCache::Entry &entry) { return entry.registry.expired(); });
+
+  const auto beans = registry->add();
+  t_cache.entries.push_back({registry, beans});
+  return *beans;
+}
+
+ScopedBeans *ThreadScopeRegistry::add() {
+  const std::lock_guard lock(_mutex);
+  return _scopes.emplace_back(std::make_unique<ScopedBeans>()).get();
+}
+
+void ThreadScopeRegistry::threadExited(ScopedBeans *beans) {
+  const std::lock_guard lock(_mutex);
+  if (_closed) {
+    return;
+  }
+
+  if (const auto it = std::ranges::find(_scopes, beans, &std::unique_ptr<ScopedBeans>::get); it != _scopes.end()) {
+    _scopes.erase(it);
+  }
+}
+
+void ThreadScopeRegistry::close() {
+  const std::lock_guard lock(_mutex);
+  _closed = true;
+  _scopes.clear();
+}
+
+}// namespace framework::impl
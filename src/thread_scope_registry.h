@@ -0,0 +1,48 @@
+
+#pragma once
+
+#include "sproutpp/bean_factory.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace framework::impl {
+
+/**
+ * Class ThreadScopeRegistry
+ *
+ * Owns the thread scopes of one factory. Each thread finds its own scope through a thread-local
+ * cache, without locking; the lock is only taken when a thread first uses the factory, when it
+ * exits, and when the factory closes the registry. Whichever of the thread and the factory goes
+ * first destroys the instances of that thread. The cache does not keep the registry alive: entries
+ * of registries destroyed since are dropped the next time the thread uses a new factory.
+ */
+class ThreadScopeRegistry {
+  std::mutex _mutex;
+  bool _closed = false;
+  std::vector<std::unique_ptr<ScopedBeans>> _scopes;
+
+  ScopedBeans *add();
+  void threadExited(ScopedBeans *beans);
+
+  friend struct ThreadScopeCache;
+
+public:
+  /**
+   * \param registry the registry of the factory.
+   * \return the scope of the calling thread.
+   */
+  static ScopedBeans &beansOfThisThread(const std::shared_ptr<ThreadScopeRegistry> &registry);
+
+  /**
+   * Destroys the scopes of every thread. Threads exiting afterwards leave the registry alone.
+   *
+   * The instances of every thread are destroyed on the calling thread, while their threads may
+   * still be running: the factory only closes its registry when it goes away, by which time no
+   * other thread may use its thread scoped beans.
+   */
+  void close();
+};
+
+}// namespace framework::impl
@@ -0,0 +1,169 @@
+
+#include "typed_value_parser.h"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace {
+using framework::PropertyError;
+using framework::PropertyResult;
+
+struct Unit {
+  std::string_view name;
+  std::int64_t factor;
+};
+
+constexpr std::array DURATION_UNITS{
+    Unit{"ns", 1},
+    Unit{"us", 1'000},
+    Unit{"ms", 1'000'000},
+    Unit{"s", 1'000'000'000},
+    Unit{"m", 60'000'000'000},
+    Unit{"h", 3'600'000'000'000},
+    Unit{"d", 86'400'000'000'000},
+};
+
+constexpr std::array BYTE_SIZE_UNITS{
+    Unit{"B", 1},
+    Unit{"KB", std::int64_t{1} << 10},
+    Unit{"MB", std::int64_t{1} << 20},
+    Unit{"GB", std::int64_t{1} << 30},
+    Unit{"TB", std::int64_t{1} << 40},
+};
+
+/// Parses a whole number, an optional '+' sign allowed
+template<typename T>
+PropertyResult<T> parseNumber(std::string_view str) {
+  if (str.size() > 1 && str.front() == '+' && str[1] != '-') {
+    str.remove_prefix(1);
+  }
+
+  T result{};
+  const auto [end, ec] = std::from_chars(str.data(), str.data() + str.size(), result);
+  if (ec == std::errc::result_out_of_range) {
+    return std::unexpected(PropertyError::OUT_OF_RANGE);
+  }
+  if (ec != std::errc() || end != str.data() + str.size()) {
+    return std::unexpected(PropertyError::INVALID);
+  }
+  return result;
+}
+
+/// Parses an integer followed by one of the units, defaultFactor applying when there is none
+template<typename T, std::size_t N>
+PropertyResult<T> parseWithUnit(std::string_view str, const std::array<Unit, N> &units, std::int64_t defaultFactor) {
+  const auto unitStart = std::min(str.find_first_not_of("+-0123456789"), str.size());
+  const auto unitName = str.substr(unitStart);
+
+  auto factor = defaultFactor;
+  if (!unitName.empty()) {
+    const auto unit = std::ranges::find(units, unitName, &Unit::name);
+    if (unit == units.end()) {
+      return std::unexpected(PropertyError::INVALID);
+    }
+    factor = unit->factor;
+  }
+
+  const auto count = parseNumber<T>(str.substr(0, unitStart));
+  if (!count) {
+    return count;
+  }
+  const auto scale = static_cast<T>(factor);
+  if (*count > std::numeric_limits<T>::max() / scale) {
+    return std::unexpected(PropertyError::OUT_OF_RANGE);
+  }
+  if constexpr (std::is_signed_v<T>) {
+    if (*count < std::numeric_limits<T>::min() / scale) {
+      return std::unexpected(PropertyError::OUT_OF_RANGE);
+    }
+  }
+  return *count * scale;
+}
+
+framework::TypedValue parseString(std::string_view str) {
+  framework::TypedValue result;
+  result.integer = parseNumber<std::int64_t>(str);
+  result.floating = parseNumber<double>(str);
+
+  if (str == "true" || str == "1") {
+    result.boolean = true;
+  } else if (str == "false" || str == "0") {
+    result.boolean = false;
+  } else {
+    result.boolean = std::unexpected(PropertyError::INVALID);
+  }
+
+  if (const auto nanoseconds = parseWithUnit<std::int64_t>(str, DURATION_UNITS, 1'000'000)) {
+    result.duration = std::chrono::nanoseconds(*nanoseconds);
+  } else {
+    result.duration = std::unexpected(nanoseconds.error());
+  }
+  result.byteSize = parseWithUnit<std::uint64_t>(str, BYTE_SIZE_UNITS, 1);
+  return result;
+}
+
+framework::TypedValue parseInt(int number) {
+  framework::TypedValue result;
+  result.integer = number;
+  result.floating = number;
+  result.boolean = number == 0 || number == 1 ? PropertyResult<bool>(number == 1) : std::unexpected(PropertyError::INVALID);
+  result.duration = std::chrono::milliseconds(number);
+  result.byteSize = number >= 0 ? PropertyResult<std::uint64_t>(static_cast<std::uint64_t>(number)) : std::unexpected(PropertyError::INVALID);
+  return result;
+}
+
+framework::TypedValue parseDouble(double number) {
+  // 2^63, the bounds of an int64_t are -2^63 included and 2^63 excluded
+  constexpr double INT64_LIMIT = 9223372036854775808.0;
+
+  framework::TypedValue result;
+  result.floating = number;
+  if (number != std::trunc(number)) {
+    result.integer = std::unexpected(PropertyError::INVALID);
+  } else if (number < -INT64_LIMIT || number >= INT64_LIMIT) {
+    result.integer = std::unexpected(PropertyError::OUT_OF_RANGE);
+  } else {
+    result.integer = static_cast<std::int64_t>(number);
+  }
+  result.boolean = std::unexpected(PropertyError::INVALID);
+  result.duration = std::unexpected(PropertyError::INVALID);
+  result.byteSize = std::unexpected(PropertyError::INVALID);
+  return result;
+}
+
+framework::TypedValue parseBool(bool flag) {
+  framework::TypedValue result;
+  result.integer = std::unexpected(PropertyError::INVALID);
+  result.floating = std::unexpected(PropertyError::INVALID);
+  result.boolean = flag;
+  result.duration = std::unexpected(PropertyError::INVALID);
+  result.byteSize = std::unexpected(PropertyError::INVALID);
+  return result;
+}
+}// namespace
+
+namespace framework::impl {
+
+TypedValue parseTypedValue(const PropertySource::Value &value) {
+  if (const auto str = std::get_if<std::string>(&value)) {
+    return parseString(*str);
+  }
+  if (const auto number = std::get_if<int>(&value)) {
+    return parseInt(*number);
+  }
+  if (const auto number = std::get_if<double>(&value)) {
+    return parseDouble(*number);
+  }
+  if (const auto flag = std::get_if<bool>(&value)) {
+    return parseBool(*flag);
+  }
+  return {};
+}
+
+}// namespace framework::impl
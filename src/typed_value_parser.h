@@ -0,0 +1,17 @@
+
+#pragma once
+
+#include "sproutpp/property_source.h"
+#include "sproutpp/typed_value.h"
+
+namespace framework::impl {
+
+/**
+ * Parses a resolved value into every type it can be read as.
+ *
+ * \param value the value, std::monostate when the property is absent.
+ * \return the parsed value, see TypedValue for the accepted formats.
+ */
+TypedValue parseTypedValue(const PropertySource::Value &value);
+
+}// namespace framework::impl
@@ -0,0 +1,124 @@
+
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+namespace {
+/// Pool and queue of the worker running on this thread, if any
+thread_local const void *t_pool = nullptr;
+thread_local std::size_t t_queue = 0;
+}// namespace
+
+namespace framework::impl {
+WorkStealingPool::WorkStealingPool(std::size_t threads) {
+  threads = std::max<std::size_t>(threads, 1);
+
+  _queues.reserve(threads);
+  for (std::size_t i = 0; i < threads; i++) {
+    _queues.push_back(std::make_unique<Queue>());
+  }
+
+  _workers.reserve(threads);
+  for (std::size_t i = 0; i < threads; i++) {
+    _workers.emplace_back([this, i] { workerLoop(i); });
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  wait();
+  {
+    const std::lock_guard lock(_mutex);
+    _stopping = true;
+  }
+  _work.notify_all();
+
+  for (auto &worker: _workers) {
+    worker.join();
+  }
+}
+
+void WorkStealingPool::submit(Task task) {
+  // Counted first, so the task can never complete before it is accounted for
+  std::size_t index;
+  {
+    const std::lock_guard lock(_mutex);
+    index = t_pool == this ? t_queue : _next_queue++ % _queues.size();
+    _queued++;
+    _pending++;
+  }
+
+  {
+    auto &queue = *_queues[index];
+    const std::lock_guard lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  _work.notify_one();
+}
+
+void WorkStealingPool::wait() {
+  std::unique_lock lock(_mutex);
+  _idle.wait(lock, [this] { return _pending == 0; });
+}
+
+bool WorkStealingPool::tryRun(std::size_t index) {
+  Task task;
+
+  // Own queue newest first, it is the most likely to be warm
+  {
+    auto &queue = *_queues[index];
+    const std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    }
+  }
+
+  // Then steal the oldest task of another queue
+  for (std::size_t i = 1; !task && i < _queues.size(); i++) {
+    auto &queue = *_queues[(index + i) % _queues.size()];
+    const std::lock_guard lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+  }
+
+  if (!task) {
+    return false;
+  }
+
+  {
+    const std::lock_guard lock(_mutex);
+    _queued--;
+  }
+
+  task();
+
+  bool idle;
+  {
+    const std::lock_guard lock(_mutex);
+    idle = --_pending == 0;
+  }
+  if (idle) {
+    _idle.notify_all();
+  }
+  return true;
+}
+
+void WorkStealingPool::workerLoop(std::size_t index) {
+  t_pool = this;
+  t_queue = index;
+
+  for (;;) {
+    if (tryRun(index)) {
+      continue;
+    }
+
+    std::unique_lock lock(_mutex);
+    _work.wait(lock, [this] { return _stopping || _queued != 0; });
+    if (_stopping && _queued == 0) {
+      return;
+    }
+  }
+}
+}// namespace framework::impl
@@ -0,0 +1,80 @@
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace framework::impl {
+
+/**
+ * Class WorkStealingPool
+ *
+ * Fixed set of worker threads, each with its own task queue. Tasks submitted from a worker go to
+ * the back of its queue and the worker runs them newest first; idle workers steal the oldest
+ * tasks of the other queues. Tasks submitted from outside the pool are spread round robin.
+ *
+ * Meant for coarse tasks (one bean construction each): the bookkeeping takes a lock per task.
+ * Tasks must not throw.
+ */
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+private:
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  std::vector<std::unique_ptr<Queue>> _queues;
+  std::vector<std::thread> _workers;
+
+  std::mutex _mutex;
+  /// Signalled when a task is queued or the pool stops
+  std::condition_variable _work;
+  /// Signalled when the last pending task completes
+  std::condition_variable _idle;
+  /// Tasks sitting in a queue
+  std::size_t _queued = 0;
+  /// Tasks submitted and not completed yet
+  std::size_t _pending = 0;
+  std::size_t _next_queue = 0;
+  bool _stopping = false;
+
+  void workerLoop(std::size_t index);
+  bool tryRun(std::size_t index);
+
+public:
+  /**
+   * Starts the workers.
+   *
+   * \param threads number of workers; at least one is started.
+   */
+  explicit WorkStealingPool(std::size_t threads);
+
+  /// Waits for the pending tasks then joins the workers
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  std::size_t size() const { return _workers.size(); }
+
+  /**
+   * Queues a task. Can be called from inside a task.
+   */
+  void submit(Task task);
+
+  /**
+   * Blocks until every submitted task, including the ones they submitted, has completed.
+   */
+  void wait();
+};
+
+}// namespace framework::impl
@@ -0,0 +1,250 @@
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include "sproutpp/application_context.h"
+#include "sproutpp/bean_pool.h"
+#include "sproutpp/bean_ref.h"
+#include "sproutpp/static_context.h"
+
+#include "compositing_property_resolver.h"
+#include "default_bean_factory_impl.h"
+#include "property_sources/environment_property_source.h"
+#include "property_sources/map_property_source.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+struct Service {
+  int value = 42;
+};
+
+auto createApplicationContext(const char *argv0) {
+  char *argv[] = {const_cast<char *>(argv0), nullptr};
+  auto application_context = framework::ApplicationContext::Create(1, argv);
+  application_context->initialize();
+  return application_context;
+}
+
+/// Threads started once, so that a benchmark only times the reads they run, not their creation
+class ReaderThreads {
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  std::function<void()> _read;
+  std::uint64_t _round = 0;
+  std::size_t _running = 0;
+  bool _stopping = false;
+  std::vector<std::thread> _threads;
+
+public:
+  explicit ReaderThreads(int count) {
+    for (int t = 0; t < count; t++) {
+      _threads.emplace_back([this] {
+        std::uint64_t seen = 0;
+        std::unique_lock lock(_mutex);
+        while (true) {
+          _changed.wait(lock, [&] { return _stopping || _round != seen; });
+          if (_stopping) {
+            return;
+          }
+          seen = _round;
+          lock.unlock();
+          _read();
+          lock.lock();
+          if (--_running == 0) {
+            _changed.notify_all();
+          }
+        }
+      });
+    }
+  }
+
+  ~ReaderThreads() {
+    {
+      const std::lock_guard lock(_mutex);
+      _stopping = true;
+    }
+    _changed.notify_all();
+    for (auto &thread: _threads) {
+      thread.join();
+    }
+  }
+
+  /// Releases every thread at once to run read, and waits until they are all done
+  void run(std::function<void()> read) {
+    std::unique_lock lock(_mutex);
+    _read = std::move(read);
+    _running = _threads.size();
+    _round++;
+    _changed.notify_all();
+    _changed.wait(lock, [this] { return _running == 0; });
+  }
+};
+}// namespace
+
+TEST_CASE("Benchmark first bean lookup") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  const auto service = ac->createSingleton<Service>();
+
+  const framework::BeanRef<Service> ref{*ac};
+  REQUIRE(ref.get() == service);
+
+  BENCHMARK("raw pointer") {
+    return service->value;
+  };
+
+  BENCHMARK("BeanRef::get") {
+    return ref->value;
+  };
+
+  BENCHMARK("getFirstBeanTyped") {
+    return ac->getFirstBeanTyped<Service>()->value;
+  };
+
+  framework::StaticContext<Service> context;
+  BENCHMARK("StaticContext::get") {
+    return context.get<Service>().value;
+  };
+
+  BENCHMARK("getScopedBean(THREAD)") {
+    const auto scoped = ac->getScopedBean<Service>(framework::BeanScope::THREAD);
+    return scoped != nullptr ? scoped->value : 0;
+  };
+}
+
+TEST_CASE("Benchmark concurrent lookups") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  const auto service = ac->createSingleton<Service>();
+  auto &factory = dynamic_cast<framework::impl::DefaultBeanFactoryImpl &>(*ac);
+  factory.enableConcurrentAccess();
+
+  for (const auto threads: {1, 2, 4, 8}) {
+    ReaderThreads readers(threads);
+    std::atomic<int> sum{0};
+    BENCHMARK("getFirstBeanTyped x100000, " + std::to_string(threads) + " threads") {
+      sum = 0;
+      readers.run([&] {
+        int local = 0;
+        for (int i = 0; i < 100000; i++) {
+          local += ac->getFirstBeanTyped<Service>()->value;
+        }
+        sum += local;
+      });
+      return sum.load() == 4200000 * threads && service != nullptr;
+    };
+  }
+}
+
+TEST_CASE("Benchmark prototype instances") {
+  struct Request : framework::ResettableBean {
+    std::string payload;
+    void resetBean() override { payload.clear(); }
+  };
+
+  const auto ac = createApplicationContext(__FUNCTION__);
+  auto &pool = ac->getBeanPool<Request>();
+
+  // Registered instances pile up until the context goes away
+  BENCHMARK("getNewInstance") {
+    return ac->getNewInstance<Request>();
+  };
+
+  BENCHMARK("BeanPool::acquire") {
+    return pool.acquire()->payload.size();
+  };
+
+  BENCHMARK("getPooledInstance") {
+    return ac->getPooledInstance<Request>()->payload.size();
+  };
+}
+
+TEST_CASE("Benchmark child contexts") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  ac->createSingleton<Service>();
+  const auto child = ac->createChildContext("tenant");
+
+  BENCHMARK("createChildContext") {
+    return ac->createChildContext("tenant");
+  };
+
+  BENCHMARK("child getFirstBeanTyped, from the parent") {
+    return child->getFirstBeanTyped<Service>()->value;
+  };
+
+  BENCHMARK("child getPropertyAsInt, from the parent") {
+    return child->getPropertyAsInt("beans.init.threads", 1);
+  };
+}
+
+TEST_CASE("Benchmark property lookups") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  source->setProperty("service.limit", "42");
+  ac->registerPropertySource(std::move(source));
+  const auto &limit = ac->getPropertyHandle<int>("service.limit");
+
+  BENCHMARK("getPropertyAsInt") {
+    return ac->getPropertyAsInt("service.limit");
+  };
+
+  BENCHMARK("getPropertyAsInt64") {
+    return ac->getPropertyAsInt64("service.limit").value_or(0);
+  };
+
+  BENCHMARK("getPropertyView") {
+    return std::get<std::string_view>(*ac->getPropertyView("service.limit")).size();
+  };
+
+  BENCHMARK("PropertyHandle::get") {
+    return limit.get();
+  };
+}
+
+TEST_CASE("Benchmark environment lookups") {
+  using framework::impl::EnvironmentPropertySource;
+  const EnvironmentPropertySource live;
+  const EnvironmentPropertySource snapshot(EnvironmentPropertySource::Mode::SNAPSHOT);
+
+  BENCHMARK("live containsProperty") {
+    return live.containsProperty("path");
+  };
+
+  BENCHMARK("snapshot containsProperty") {
+    return snapshot.containsProperty("path");
+  };
+}
+
+TEST_CASE("Benchmark concurrent property lookups") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  source->setProperty("service.limit", 42);
+  resolver.registerPropertySource(std::move(source));
+
+  for (const auto concurrent: {false, true}) {
+    if (concurrent) {
+      resolver.enableConcurrentPropertyAccess();
+    }
+
+    for (const auto threads: {1, 2, 4, 8}) {
+      ReaderThreads readers(threads);
+      std::atomic<int> sum{0};
+      BENCHMARK(std::string(concurrent ? "snapshot" : "mutex") + " getPropertyAsInt x100000, " + std::to_string(threads) + " threads") {
+        sum = 0;
+        readers.run([&] {
+          int local = 0;
+          for (int i = 0; i < 100000; i++) {
+            local += resolver.getPropertyAsInt("service.limit");
+          }
+          sum += local;
+        });
+        return sum.load() == 4200000 * threads;
+      };
+    }
+  }
+}
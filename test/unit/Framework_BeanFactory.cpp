@@ -1,8 +1,33 @@
 #include "catch2/catch_session.hpp"
 #include "sproutpp/application_context.h"
+#include "sproutpp/bean_pool.h"
+#include "sproutpp/bean_ref.h"
+#include "sproutpp/request_scope.h"
+#include "sproutpp/static_context.h"
 #include <catch2/catch_test_macros.hpp>
 
+#include "default_bean_factory_impl.h"
+#include "property_sources/map_property_source.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory_resource>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
 namespace {
+class TestBeanFactory : public framework::impl::DefaultBeanFactoryImpl {
+protected:
+  void applicationContextAwareCreated(framework::ApplicationContextAware *) override {}
+
+public:
+  using DefaultBeanFactoryImpl::destroyBean;
+  using DefaultBeanFactoryImpl::DefaultBeanFactoryImpl;
+};
+
 auto createApplicationContext(const char* argv0) {
   char *argv[] = {const_cast<char *>(argv0), nullptr};
   auto application_context = framework::ApplicationContext::Create(1, argv);
@@ -63,3 +88,1033 @@ TEST_CASE("Can name beans") {
   REQUIRE(ac->getBeanTyped<Tst>("test") != nullptr);
   REQUIRE(ac->getBeanTyped<Tst>("test2") == nullptr);
 }
+
+TEST_CASE("Bean names are unique") {
+  struct Tst {};
+  const auto ac = createApplicationContext(__FUNCTION__);
+
+  const auto first = ac->registerExistingBean(std::make_unique<Tst>(), "test");
+  REQUIRE(first != nullptr);
+  REQUIRE(ac->createSingleton<Tst>() != nullptr);
+  REQUIRE(ac->createSingleton<Tst>() == nullptr);
+
+  REQUIRE(ac->getBeanTyped<Tst>("test") == first);
+}
+
+TEST_CASE("Can lookup bean names") {
+  struct Tst {};
+  const auto ac = createApplicationContext(__FUNCTION__);
+
+  const auto test = ac->registerExistingBean(std::make_unique<Tst>(), "test");
+  Tst unknown;
+
+  REQUIRE(ac->isBeanKnown(test));
+  REQUIRE(ac->beanName(test) == "test");
+  REQUIRE_FALSE(ac->isBeanKnown(&unknown));
+  REQUIRE(ac->beanName(&unknown).empty());
+}
+
+TEST_CASE("Can find all beans of a type") {
+  struct Tst {};
+  struct Other {};
+  const auto ac = createApplicationContext(__FUNCTION__);
+
+  const auto test1 = ac->getNewInstance<Tst>();
+  const auto other = ac->getNewInstance<Other>();
+  const auto test2 = ac->getNewInstance<Tst>();
+
+  REQUIRE(ac->getBeansTyped<Tst>() == std::vector<Tst *>{test1, test2});
+  REQUIRE(ac->getBeansTyped<Other>() == std::vector<Other *>{other});
+  REQUIRE(ac->getFirstBeanTyped<Tst>() == test1);
+  REQUIRE(ac->beanName(test1) != ac->beanName(test2));
+}
+
+TEST_CASE("Bean ref follows the first bean of its type") {
+  struct Tst {};
+  TestBeanFactory factory;
+
+  const framework::BeanRef<Tst> ref{factory};
+  REQUIRE(ref.get() == nullptr);
+
+  const auto test1 = factory.getNewInstance<Tst>();
+  const auto test2 = factory.getNewInstance<Tst>();
+  REQUIRE(ref.get() == test1);
+
+  factory.destroyBean(test2);
+  REQUIRE(ref.get() == test1);
+
+  factory.destroyBean(test1);
+  REQUIRE(ref.get() == nullptr);
+}
+
+TEST_CASE("Beans are allocated from the factory memory resource") {
+  struct Tst {
+    int *destroyed;
+    explicit Tst(int *counter) : destroyed(counter) {}
+    ~Tst() { (*destroyed)++; }
+  };
+
+  int destroyed = 0;
+  std::pmr::monotonic_buffer_resource arena;
+  {
+    TestBeanFactory factory{&arena};
+    const auto test1 = factory.createSingleton<Tst>(&destroyed);
+    const auto test2 = factory.registerExistingBean(std::make_unique<Tst>(&destroyed), "test");
+    REQUIRE(test1 != nullptr);
+    REQUIRE(test2 != nullptr);
+
+    REQUIRE(factory.destroyBean(test1));
+    REQUIRE_FALSE(factory.destroyBean(test1));
+    REQUIRE(destroyed == 1);
+  }
+
+  REQUIRE(destroyed == 2);
+}
+
+TEST_CASE("A bean whose constructor throws is neither registered nor leaked") {
+  struct Counting : std::pmr::memory_resource {
+    int allocated = 0;
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      allocated++;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      allocated--;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+  };
+  struct Throwing {
+    explicit Throwing(int value) {
+      if (value < 0) {
+        throw std::invalid_argument("negative");
+      }
+    }
+  };
+
+  Counting resource;
+  TestBeanFactory factory{&resource};
+  REQUIRE_THROWS_AS(factory.createSingleton<Throwing>(-1), std::invalid_argument);
+  REQUIRE(resource.allocated == 0);
+  REQUIRE(factory.getFirstBeanTyped<Throwing>() == nullptr);
+
+  // The name was not taken by the failed attempt
+  REQUIRE(factory.createSingleton<Throwing>(1) != nullptr);
+}
+
+TEST_CASE("Destroyed prototypes give their memory back") {
+  struct Counting : std::pmr::memory_resource {
+    int allocated = 0;
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      allocated++;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      allocated--;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+  };
+  struct Tst {};
+
+  std::pmr::monotonic_buffer_resource arena;
+  Counting prototypes;
+  TestBeanFactory factory{&arena};
+  factory.setPrototypeMemoryResource(&prototypes);
+
+  const auto singleton = factory.createSingleton<Tst>();
+  const auto instance = factory.getNewInstance<Tst>();
+  REQUIRE(singleton != nullptr);
+  REQUIRE(instance != nullptr);
+  REQUIRE(prototypes.allocated == 1);
+
+  REQUIRE(factory.destroyBean(instance));
+  REQUIRE(prototypes.allocated == 0);
+}
+
+TEST_CASE("Context destroys its beans") {
+  struct Tst {
+    int *destroyed;
+    explicit Tst(int *counter) : destroyed(counter) {}
+    ~Tst() { (*destroyed)++; }
+  };
+
+  int destroyed = 0;
+  {
+    const auto ac = createApplicationContext(__FUNCTION__);
+    ac->createSingleton<Tst>(&destroyed);
+    ac->registerExistingBean(std::make_unique<Tst>(&destroyed), "test");
+  }
+
+  REQUIRE(destroyed == 2);
+}
+
+TEST_CASE("Default bean names skip names already taken") {
+  struct Tst {};
+  const auto ac = createApplicationContext(__FUNCTION__);
+
+  const auto test0 = ac->getNewInstance<Tst>();
+  const auto name0 = std::string(ac->beanName(test0));
+  REQUIRE(name0.ends_with("_0"));
+
+  const auto prefix = name0.substr(0, name0.size() - 1);
+  const auto test1 = ac->registerExistingBean(std::make_unique<Tst>(), prefix + "2");
+  const auto test2 = ac->getNewInstance<Tst>();
+
+  REQUIRE(test1 != nullptr);
+  REQUIRE(test2 != nullptr);
+  REQUIRE(ac->beanName(test2) == prefix + "3");
+  REQUIRE(ac->getBeanTyped<Tst>(prefix + "2") == test1);
+}
+
+TEST_CASE("Beans are destroyed newest first") {
+  struct Tst {
+    framework::BeanFactory *factory;
+    std::vector<int> *order;
+    int id;
+    Tst(framework::BeanFactory *beanFactory, std::vector<int> *destroyed, int beanId)
+        : factory(beanFactory), order(destroyed), id(beanId) {}
+    ~Tst() {
+      order->push_back(id);
+      // Beans destroyed before this one must not be handed out anymore
+      for (const auto other: factory->getBeansTyped<Tst>()) {
+        REQUIRE(other->id <= id);
+      }
+    }
+  };
+
+  std::vector<int> order;
+  {
+    TestBeanFactory factory;
+    factory.registerExistingBean(std::make_unique<Tst>(&factory, &order, 0), "first");
+    factory.registerExistingBean(std::make_unique<Tst>(&factory, &order, 1), "second");
+    factory.registerExistingBean(std::make_unique<Tst>(&factory, &order, 2), "third");
+  }
+
+  REQUIRE(order == std::vector<int>{2, 1, 0});
+}
+
+TEST_CASE("Concurrent lookups see a consistent registry while beans are registered") {
+  struct Service {
+    int value = 42;
+  };
+  struct Tst {};
+
+  TestBeanFactory factory;
+  const auto service = factory.createSingleton<Service>();
+  factory.enableConcurrentAccess();
+
+  std::atomic<bool> done{false};
+  std::atomic<int> failures{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      const framework::BeanRef<Service> ref{factory};
+      while (!done.load()) {
+        if (factory.getFirstBeanTyped<Service>() != service || factory.getBeanTyped<Service>(factory.beanName(service)) != service ||
+            ref->value != 42) {
+          failures++;
+        }
+        if (factory.getBeansTyped<Tst>().size() > 101) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  std::vector<Tst *> created;
+  for (std::size_t i = 0; i < 200; i++) {
+    created.push_back(factory.getNewInstance<Tst>());
+    if (i % 2 == 1) {
+      REQUIRE(factory.destroyBean(created[i - 1]));
+    }
+  }
+  done = true;
+  for (auto &reader: readers) {
+    reader.join();
+  }
+
+  REQUIRE(failures == 0);
+  REQUIRE(factory.getBeansTyped<Tst>().size() == 100);
+  REQUIRE(factory.getFirstBeanTyped<Tst>() == created[1]);
+}
+
+TEST_CASE("Concurrent lookups only see constructed beans") {
+  struct Slow {
+    int value = 0;
+    Slow() {
+      std::this_thread::yield();
+      value = 42;
+    }
+  };
+
+  TestBeanFactory factory;
+  factory.createSingleton<Slow>();
+  factory.enableConcurrentAccess();
+
+  std::atomic<bool> done{false};
+  std::atomic<int> failures{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      while (!done.load()) {
+        const auto first = factory.getFirstBeanTyped<Slow>();
+        if (first == nullptr || first->value != 42) {
+          failures++;
+        }
+      }
+    });
+  }
+
+  for (int i = 0; i < 100; i++) {
+    factory.getNewInstance<Slow>();
+  }
+  done = true;
+  for (auto &reader: readers) {
+    reader.join();
+  }
+
+  REQUIRE(failures == 0);
+  for (const auto slow: factory.getBeansTyped<Slow>()) {
+    REQUIRE(slow->value == 42);
+  }
+}
+
+TEST_CASE("Default bean names stay unique across threads") {
+  struct Tst {};
+
+  TestBeanFactory factory;
+  factory.enableConcurrentAccess();
+
+  std::vector<std::thread> writers;
+  for (int i = 0; i < 4; i++) {
+    writers.emplace_back([&] {
+      for (int j = 0; j < 50; j++) {
+        factory.getNewInstance<Tst>();
+      }
+    });
+  }
+  for (auto &writer: writers) {
+    writer.join();
+  }
+
+  REQUIRE(factory.getBeansTyped<Tst>().size() == 200);
+}
+
+TEST_CASE("Lazy beans are built on first lookup") {
+  struct Tst : framework::BeanFactoryAware {
+    int value;
+    bool aware = false;
+    explicit Tst(int v) : value(v) {}
+    void setBeanFactory(framework::BeanFactory &) override { aware = true; }
+  };
+
+  int built = 0;
+  const auto ac = createApplicationContext(__FUNCTION__);
+  REQUIRE(ac->defineLazyBean<Tst>("lazy", [&] {
+    built++;
+    return Tst{42};
+  }));
+  REQUIRE_FALSE(ac->defineLazyBean<Tst>("lazy", [] { return Tst{0}; }));
+  REQUIRE(built == 0);
+
+  const auto test = ac->getBeanTyped<Tst>("lazy");
+  REQUIRE(built == 1);
+  REQUIRE(test != nullptr);
+  REQUIRE(test->value == 42);
+  REQUIRE(test->aware);
+  REQUIRE(ac->getFirstBeanTyped<Tst>() == test);
+  REQUIRE(ac->getBeansTyped<Tst>() == std::vector<Tst *>{test});
+  REQUIRE(built == 1);
+}
+
+TEST_CASE("Lazy beans are only destroyed once built") {
+  struct Tst {
+    int *destroyed;
+    explicit Tst(int *counter) : destroyed(counter) {}
+    ~Tst() { (*destroyed)++; }
+  };
+
+  int destroyed = 0;
+  {
+    TestBeanFactory factory;
+    factory.defineLazyBean<Tst>("unused", [&] { return Tst{&destroyed}; });
+    factory.defineLazyBean<Tst>("used", [&] { return Tst{&destroyed}; });
+    REQUIRE(factory.getBeanTyped<Tst>("used") != nullptr);
+    REQUIRE(destroyed == 0);
+  }
+
+  // "unused" was never built
+  REQUIRE(destroyed == 1);
+}
+
+TEST_CASE("A built lazy bean is no longer handed out once destroyed") {
+  struct Svc {
+    framework::BeanFactory *factory;
+    int id;
+    std::vector<int> *seen;
+    Svc(framework::BeanFactory *beanFactory, int beanId, std::vector<int> *firstSeen)
+        : factory(beanFactory), id(beanId), seen(firstSeen) {}
+    ~Svc() {
+      if (seen != nullptr) {
+        const auto first = factory->getFirstBeanTyped<Svc>();
+        seen->push_back(first == nullptr ? 0 : first == this ? -1 : first->id);
+      }
+    }
+  };
+
+  std::vector<int> seen;
+  {
+    TestBeanFactory factory;
+    factory.defineLazyBean<Svc>("lazy", [&] { return Svc{&factory, 1, &seen}; });
+    factory.registerExistingBean(std::make_unique<Svc>(&factory, 2, &seen), "eager");
+
+    // Built on lookup, the lazy bean is now the first to be destroyed but stays first of its type
+    REQUIRE(factory.getFirstBeanTyped<Svc>()->id == 1);
+  }
+
+  // ~Svc(1) finds Svc(2), ~Svc(2) finds nothing
+  REQUIRE(seen == std::vector<int>{2, 0});
+}
+
+TEST_CASE("Lazy beans are destroyed before the beans they looked up") {
+  struct Dependency {
+    std::vector<std::string> *order;
+    ~Dependency() { order->push_back("dependency"); }
+  };
+  struct Tst {
+    Dependency *dependency;
+    std::vector<std::string> *order;
+    ~Tst() { order->push_back("lazy"); }
+  };
+
+  std::vector<std::string> order;
+  {
+    TestBeanFactory factory;
+    factory.defineLazyBean<Tst>("lazy", [&](framework::BeanFactory &beans) {
+      return Tst{beans.getFirstBeanTyped<Dependency>(), &order};
+    });
+    factory.createSingleton<Dependency>(&order);
+    REQUIRE(factory.getFirstBeanTyped<Tst>()->dependency != nullptr);
+  }
+
+  REQUIRE(order == std::vector<std::string>{"lazy", "dependency"});
+}
+
+TEST_CASE("Concurrent first lookups build a lazy bean once") {
+  struct Tst {
+    int value;
+  };
+
+  TestBeanFactory factory;
+  std::atomic<int> built{0};
+  factory.defineLazyBean<Tst>("lazy", [&] {
+    built++;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    return Tst{42};
+  });
+  factory.enableConcurrentAccess();
+
+  std::atomic<int> failures{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; i++) {
+    readers.emplace_back([&] {
+      const auto test = factory.getFirstBeanTyped<Tst>();
+      if (test == nullptr || test->value != 42) {
+        failures++;
+      }
+    });
+  }
+  for (auto &reader: readers) {
+    reader.join();
+  }
+
+  REQUIRE(built == 1);
+  REQUIRE(failures == 0);
+}
+
+TEST_CASE("A lazy bean can be destroyed while a lookup builds it") {
+  struct Tst {
+    std::atomic<void *> *storage;
+    std::atomic<int> *destroyed;
+    Tst(std::atomic<void *> *at, std::atomic<int> *counter) : storage(at), destroyed(counter) {
+      // Let the other thread remove the bean in the middle of the build
+      storage->store(this);
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    ~Tst() { (*destroyed)++; }
+  };
+
+  std::atomic<void *> storage{nullptr};
+  std::atomic<int> destroyed{0};
+  TestBeanFactory factory;
+  factory.defineLazyBean<Tst>("lazy", [&] { return Tst{&storage, &destroyed}; });
+  factory.enableConcurrentAccess();
+
+  std::thread lookup([&] { factory.getFirstBeanTyped<Tst>(); });
+  while (storage.load() == nullptr) {
+    std::this_thread::yield();
+  }
+  REQUIRE(factory.destroyBean(storage.load()));
+  lookup.join();
+
+  REQUIRE(destroyed == 1);
+  REQUIRE(factory.getFirstBeanTyped<Tst>() == nullptr);
+}
+
+TEST_CASE("Eager beans are built after their dependencies") {
+  struct Tst {
+    int order;
+  };
+
+  TestBeanFactory factory;
+  std::atomic<int> sequence{0};
+  const auto make = [&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    return Tst{sequence++};
+  };
+
+  // config <- cache, model <- service
+  REQUIRE(factory.defineBean<Tst>("service", {"cache", "model"}, make));
+  REQUIRE(factory.defineBean<Tst>("cache", {"config"}, make));
+  REQUIRE(factory.defineBean<Tst>("model", {}, make));
+  REQUIRE(factory.defineBean<Tst>("config", {"not a bean"}, make));
+  REQUIRE(sequence == 0);
+
+  factory.enableConcurrentAccess();
+  const auto report = factory.initializeEagerBeans(4);
+  REQUIRE(report.built == 4);
+  REQUIRE(report.unresolved.empty());
+  REQUIRE(sequence == 4);
+
+  const auto order = [&](std::string_view name) { return factory.getBeanTyped<Tst>(name)->order; };
+  REQUIRE(order("config") < order("cache"));
+  REQUIRE(order("cache") < order("service"));
+  REQUIRE(order("model") < order("service"));
+
+  REQUIRE(report.criticalPath.size() == 3);
+  REQUIRE(report.criticalPath.front().name == "config");
+  REQUIRE(report.criticalPath.back().name == "service");
+
+  // Already built, nothing left to do
+  REQUIRE(factory.initializeEagerBeans(4).built == 0);
+}
+
+TEST_CASE("Eager beans are built on the calling thread outside concurrent mode") {
+  struct Tst {};
+
+  TestBeanFactory factory;
+  std::vector<std::thread::id> threads;
+  const auto make = [&] {
+    threads.push_back(std::this_thread::get_id());
+    return Tst{};
+  };
+  factory.defineBean<Tst>("a", {}, make);
+  factory.defineBean<Tst>("b", {}, make);
+  factory.defineBean<Tst>("c", {"a"}, make);
+
+  REQUIRE(factory.initializeEagerBeans(4).built == 3);
+  REQUIRE(threads == std::vector<std::thread::id>(3, std::this_thread::get_id()));
+}
+
+TEST_CASE("Eager beans in a dependency cycle are not built") {
+  struct Tst {};
+
+  TestBeanFactory factory;
+  int built = 0;
+  const auto make = [&] {
+    built++;
+    return Tst{};
+  };
+  factory.defineBean<Tst>("a", {"b"}, make);
+  factory.defineBean<Tst>("b", {"a"}, make);
+  factory.defineBean<Tst>("c", {"b"}, make);
+  factory.defineBean<Tst>("d", {}, make);
+
+  const auto report = factory.initializeEagerBeans(2);
+  REQUIRE(report.built == 0);
+  REQUIRE(report.unresolved == std::vector<std::string>{"a", "b", "c"});
+  REQUIRE(built == 0);
+}
+
+TEST_CASE("Context initialization builds the eager beans") {
+  struct Tst {};
+
+  char name[] = "eager";
+  char *argv[] = {name, nullptr};
+  const auto ac = framework::ApplicationContext::Create(1, argv);
+  int built = 0;
+  ac->defineBean<Tst>("eager", {}, [&] {
+    built++;
+    return Tst{};
+  });
+  REQUIRE(built == 0);
+
+  ac->initialize();
+  REQUIRE(built == 1);
+  REQUIRE(ac->getBeanTyped<Tst>("eager") != nullptr);
+}
+
+TEST_CASE("Pooled instances are recycled") {
+  struct Tst : framework::ResettableBean, framework::BeanFactoryAware {
+    int value = 0;
+    int wired = 0;
+    void resetBean() override { value = 0; }
+    void setBeanFactory(framework::BeanFactory &) override { wired++; }
+  };
+
+  TestBeanFactory factory;
+  Tst *first;
+  {
+    auto test = factory.getPooledInstance<Tst>();
+    REQUIRE(test != nullptr);
+    REQUIRE(test->wired == 1);
+    test->value = 42;
+    first = test.get();
+  }
+
+  auto &pool = factory.getBeanPool<Tst>();
+  const auto test1 = pool.acquire();
+  const auto test2 = pool.acquire();
+  REQUIRE(test1.get() == first);
+  REQUIRE(test1->value == 0);
+  REQUIRE(test1->wired == 1);
+  REQUIRE(test2.get() != first);
+
+  // Pooled instances are not registered
+  REQUIRE_FALSE(factory.isBeanKnown(test1.get()));
+  REQUIRE(factory.getFirstBeanTyped<Tst>() == nullptr);
+}
+
+TEST_CASE("Bean pools keep a bounded number of idle instances") {
+  struct Tst : framework::ResettableBean {
+    int *destroyed;
+    Tst() : destroyed(nullptr) {}
+    ~Tst() override {
+      if (destroyed != nullptr) {
+        (*destroyed)++;
+      }
+    }
+    void resetBean() override {}
+  };
+
+  int destroyed = 0;
+  {
+    TestBeanFactory factory;
+    auto &pool = factory.getBeanPool<Tst>(2);
+    {
+      std::vector<framework::BeanPool<Tst>::Handle> handles;
+      for (int i = 0; i < 5; i++) {
+        handles.push_back(pool.acquire());
+        handles.back()->destroyed = &destroyed;
+      }
+    }
+    // Only two fit in the free list
+    REQUIRE(destroyed == 3);
+  }
+
+  // The idle ones go with the factory
+  REQUIRE(destroyed == 5);
+}
+
+TEST_CASE("Bean pools can be used from several threads") {
+  struct Tst : framework::ResettableBean {
+    int value = 0;
+    void resetBean() override { value = 0; }
+  };
+
+  // The factory resource is not thread-safe, the pool does not allocate from it
+  std::pmr::monotonic_buffer_resource arena;
+  TestBeanFactory factory{&arena};
+  auto &pool = factory.getBeanPool<Tst>(1);
+
+  std::atomic<int> failures{0};
+  std::vector<std::thread> workers;
+  for (int i = 0; i < 4; i++) {
+    workers.emplace_back([&] {
+      for (int j = 0; j < 200; j++) {
+        const auto first = pool.acquire();
+        const auto second = pool.acquire();
+        if (first->value != 0 || second->value != 0) {
+          failures++;
+        }
+        first->value = j + 1;
+        second->value = j + 1;
+      }
+    });
+  }
+  for (auto &worker: workers) {
+    worker.join();
+  }
+
+  REQUIRE(failures == 0);
+}
+
+namespace {
+struct ThreadScoped {
+  static inline std::atomic<int> destroyed{0};
+  int value = 0;
+  ~ThreadScoped() { destroyed++; }
+};
+}// namespace
+
+TEST_CASE("Thread scoped beans are per thread") {
+  using Tst = ThreadScoped;
+
+  {
+    TestBeanFactory factory;
+    const auto mine = factory.getScopedBean<Tst>(framework::BeanScope::THREAD);
+    REQUIRE(mine != nullptr);
+    REQUIRE(factory.getScopedBean<Tst>(framework::BeanScope::THREAD) == mine);
+    REQUIRE_FALSE(factory.isBeanKnown(mine));
+
+    Tst *theirs = nullptr;
+    std::thread([&] {
+      theirs = factory.getScopedBean<Tst>(framework::BeanScope::THREAD);
+      theirs->value = 42;
+    }).join();
+
+    // Gone with its thread
+    REQUIRE(theirs != mine);
+    REQUIRE(mine->value == 0);
+    REQUIRE(Tst::destroyed == 1);
+  }
+
+  // The one of this thread goes with the factory
+  REQUIRE(Tst::destroyed == 2);
+}
+
+TEST_CASE("A thread gets a new scope from each factory it uses") {
+  using Tst = ThreadScoped;
+
+  Tst::destroyed = 0;
+  for (int i = 0; i < 10; i++) {
+    TestBeanFactory factory;
+    const auto bean = factory.getScopedBean<Tst>(framework::BeanScope::THREAD);
+    REQUIRE(bean->value == 0);
+    bean->value = i + 1;
+  }
+
+  // Every factory destroyed the instance of this thread, whose scope it no longer finds
+  REQUIRE(Tst::destroyed == 10);
+}
+
+TEST_CASE("Request scoped beans are destroyed with their scope") {
+  struct Tst : framework::BeanFactoryAware {
+    std::vector<int> *destroyed = nullptr;
+    int id = 0;
+    bool wired = false;
+    void setBeanFactory(framework::BeanFactory &) override { wired = true; }
+    ~Tst() override {
+      if (destroyed != nullptr) {
+        destroyed->push_back(id);
+      }
+    }
+  };
+  struct Other {};
+
+  TestBeanFactory factory;
+  std::vector<int> destroyed;
+  REQUIRE(factory.getScopedBean<Tst>(framework::BeanScope::REQUEST) == nullptr);
+
+  {
+    const framework::RequestScope outer(factory);
+    const auto outerBean = factory.getScopedBean<Tst>(framework::BeanScope::REQUEST);
+    REQUIRE(outerBean != nullptr);
+    REQUIRE(outerBean->wired);
+    outerBean->destroyed = &destroyed;
+    outerBean->id = 1;
+
+    {
+      const framework::RequestScope inner(factory);
+      const auto innerBean = factory.getScopedBean<Tst>(framework::BeanScope::REQUEST);
+      REQUIRE(innerBean != outerBean);
+      innerBean->destroyed = &destroyed;
+      innerBean->id = 2;
+      REQUIRE(factory.getScopedBean<Other>(framework::BeanScope::REQUEST) != nullptr);
+    }
+    REQUIRE(destroyed == std::vector<int>{2});
+    REQUIRE(factory.getScopedBean<Tst>(framework::BeanScope::REQUEST) == outerBean);
+
+    // Scopes of other factories are not visible
+    TestBeanFactory other;
+    REQUIRE(other.getScopedBean<Tst>(framework::BeanScope::REQUEST) == nullptr);
+  }
+
+  REQUIRE(destroyed == std::vector<int>{2, 1});
+  REQUIRE(factory.getScopedBean<Tst>(framework::BeanScope::REQUEST) == nullptr);
+}
+
+TEST_CASE("Constructors are autowired") {
+  struct Config {
+    int value = 42;
+  };
+  struct Cache {};
+  struct Missing {};
+  struct Service {
+    Config &config;
+    const Cache *cache;
+    Missing *missing;
+    Service(Config &c, const Cache *ca, Missing *m) : config(c), cache(ca), missing(m) {}
+    Service(const Service &other) = default;
+  };
+
+  TestBeanFactory factory;
+  const auto config = factory.createSingleton<Config>();
+  const auto cache = factory.createSingleton<Cache>();
+
+  const auto service = factory.createSingleton<Service>();
+  REQUIRE(service != nullptr);
+  REQUIRE(&service->config == config);
+  REQUIRE(service->cache == cache);
+  REQUIRE(service->missing == nullptr);
+
+  // getNewInstance autowires the same way
+  const auto instance = factory.getNewInstance<Service>();
+  REQUIRE(instance != nullptr);
+  REQUIRE(instance->cache == cache);
+}
+
+TEST_CASE("Autowiring fails without a bean for a reference parameter") {
+  struct Config {};
+  struct Consumer {
+    Config &config;
+    explicit Consumer(Config &c) : config(c) {}
+  };
+
+  TestBeanFactory factory;
+  REQUIRE(factory.createSingleton<Consumer>() == nullptr);
+  REQUIRE(factory.getNewInstance<Consumer>() == nullptr);
+  REQUIRE(factory.getFirstBeanTyped<Consumer>() == nullptr);
+
+  // Once the dependency exists the same call succeeds
+  factory.createSingleton<Config>();
+  REQUIRE(factory.createSingleton<Consumer>() != nullptr);
+}
+
+TEST_CASE("Static contexts build and wire their beans inline") {
+  struct Config {
+    int value = 42;
+  };
+  struct Cache {
+    const Config &config;
+    explicit Cache(const Config &c) : config(c) {}
+  };
+  struct Service : framework::BeanFactoryAware {
+    Config *config;
+    Cache &cache;
+    framework::BeanFactory *factory = nullptr;
+    std::vector<std::string> *destroyed;
+    Service(Config *c, Cache &ca) : config(c), cache(ca), destroyed(nullptr) {}
+    ~Service() override {
+      if (destroyed != nullptr) {
+        destroyed->emplace_back("service");
+      }
+    }
+    void setBeanFactory(framework::BeanFactory &f) override { factory = &f; }
+  };
+
+  std::vector<std::string> destroyed;
+  {
+    framework::StaticContext<Config, Cache, Service> context;
+    auto &service = context.get<Service>();
+    service.destroyed = &destroyed;
+
+    REQUIRE(service.config == &context.get<Config>());
+    REQUIRE(&service.cache == &context.get<Cache>());
+    REQUIRE(&context.get<Cache>().config == &context.get<Config>());
+    REQUIRE(context.get<const Config>().value == 42);
+
+    {
+      TestBeanFactory factory;
+      context.exposeTo(factory);
+      REQUIRE(factory.getFirstBeanTyped<Service>() == &service);
+      REQUIRE(service.factory == &factory);
+    }
+
+    // The factory did not destroy it
+    REQUIRE(destroyed.empty());
+  }
+
+  REQUIRE(destroyed == std::vector<std::string>{"service"});
+}
+
+namespace {
+struct Named {
+  virtual ~Named() = default;
+  virtual std::string name() const = 0;
+};
+struct Counted {
+  virtual ~Counted() = default;
+  int count = 0;
+};
+struct Greeter : Counted, Named {
+  using BeanInterfaces = std::tuple<Named, Counted>;
+  std::string name() const override { return "greeter"; }
+};
+struct Other : Named {
+  using BeanInterfaces = std::tuple<Named>;
+  std::string name() const override { return "other"; }
+};
+}// namespace
+
+TEST_CASE("Beans can be looked up by interface") {
+  TestBeanFactory factory;
+  REQUIRE(factory.getFirstBeanTyped<Named>() == nullptr);
+
+  const auto greeter = factory.createSingleton<Greeter>();
+  const auto other = factory.createSingleton<Other>();
+  const framework::BeanRef<Named> ref{factory};
+
+  // The pointers are adjusted to the interface
+  REQUIRE(factory.getFirstBeanTyped<Named>() == static_cast<Named *>(greeter));
+  REQUIRE(factory.getFirstBeanTyped<Named>()->name() == "greeter");
+  REQUIRE(factory.getFirstBeanTyped<Counted>() == static_cast<Counted *>(greeter));
+  REQUIRE(ref.get() == static_cast<Named *>(greeter));
+
+  const auto named = factory.getBeansTyped<Named>();
+  REQUIRE(named.size() == 2);
+  REQUIRE(named[1] == static_cast<Named *>(other));
+
+  // Beans registered with the interface type itself come first
+  const auto own = factory.createSingleton<Counted>();
+  REQUIRE(factory.getFirstBeanTyped<Counted>() == own);
+  REQUIRE(factory.getBeansTyped<Counted>().size() == 2);
+
+  REQUIRE(factory.destroyBean(greeter));
+  REQUIRE(factory.getFirstBeanTyped<Named>() == static_cast<Named *>(other));
+  REQUIRE(ref.get() == static_cast<Named *>(other));
+  REQUIRE(factory.getBeansTyped<Counted>().size() == 1);
+
+  // Lazy beans are indexed when defined, and built by the first lookup through an interface
+  REQUIRE(factory.defineLazyBean<Greeter>("lazy", [] { return Greeter{}; }));
+  REQUIRE(factory.destroyBean(other));
+  REQUIRE(factory.destroyBean(own));
+  const auto lazy = factory.getFirstBeanTyped<Counted>();
+  REQUIRE(lazy != nullptr);
+  REQUIRE(lazy == static_cast<Counted *>(factory.getBeanTyped<Greeter>("lazy")));
+  REQUIRE(factory.getBeansTyped<Named>().size() == 1);
+  REQUIRE(factory.getBeansTyped<Named>()[0] == static_cast<Named *>(factory.getBeanTyped<Greeter>("lazy")));
+}
+
+TEST_CASE("Child contexts fall back to their parent") {
+  struct Config {
+    int value = 0;
+  };
+  struct Tenant {};
+
+  const auto ac = createApplicationContext(__FUNCTION__);
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto properties = source.get();
+  ac->registerPropertySource(std::move(source));
+  properties->setProperty("tenant.limit", 10);
+
+  const auto child = ac->createChildContext("tenant");
+  REQUIRE(child->getParentContext() == ac.get());
+  REQUIRE(child->name() == "tenant");
+
+  // Misses go to the parent, and are cached until the parent changes
+  REQUIRE(child->getFirstBeanTyped<Config>() == nullptr);
+  const auto config = ac->createSingleton<Config>();
+  REQUIRE(child->getFirstBeanTyped<Config>() == config);
+  REQUIRE(child->getFirstBeanTyped<Config>() == config);
+  REQUIRE(child->getPropertyAsInt("tenant.limit") == 10);
+  REQUIRE(child->isBeanKnown(config));
+  REQUIRE(child->beanName(config) == ac->beanName(config));
+
+  properties->setProperty("tenant.limit", 20);
+  REQUIRE(child->getPropertyAsInt("tenant.limit") == 20);
+  REQUIRE(!child->containsProperty("tenant.name"));
+  properties->setProperty("tenant.name", "acme");
+  REQUIRE(child->getPropertyAsString("tenant.name") == "acme");
+
+  // The child's own beans and properties take precedence, and stay out of the parent
+  const auto tenant = child->createSingleton<Tenant>();
+  const auto own = child->getNewInstance<Config>();
+  REQUIRE(child->getFirstBeanTyped<Config>() == own);
+  REQUIRE(child->getBeansTyped<Config>() == std::vector<Config *>{own, config});
+  REQUIRE(ac->getFirstBeanTyped<Tenant>() == nullptr);
+  REQUIRE(child->getFirstBeanTyped<Tenant>() == tenant);
+
+  auto overrides = std::make_unique<framework::impl::MapPropertySource>();
+  overrides->setProperty("tenant.limit", 5);
+  child->registerPropertySource(std::move(overrides));
+  REQUIRE(child->getPropertyAsInt("tenant.limit") == 5);
+  REQUIRE(ac->getPropertyAsInt("tenant.limit") == 20);
+
+  // Grandchildren resolve through the whole chain
+  const auto grandchild = child->createChildContext("request");
+  REQUIRE(grandchild->getFirstBeanTyped<Tenant>() == tenant);
+  REQUIRE(grandchild->getPropertyAsInt("tenant.limit") == 5);
+  REQUIRE(grandchild->getPropertyAsString("tenant.name") == "acme");
+  properties->setProperty("tenant.name", "globex");
+  REQUIRE(grandchild->getPropertyAsString("tenant.name") == "globex");
+}
+
+TEST_CASE("Bean refs on a child context follow the parent") {
+  struct Config {};
+
+  const auto ac = createApplicationContext(__FUNCTION__);
+  const auto child = ac->createChildContext("tenant");
+  const auto grandchild = child->createChildContext("request");
+
+  const framework::BeanRef<Config> ref{*child};
+  const framework::BeanRef<Config> nested{*grandchild};
+  REQUIRE(ref.get() == nullptr);
+  REQUIRE(nested.get() == nullptr);
+
+  // Changes in the parent reach the refs of its descendants
+  const auto parent = ac->createSingleton<Config>();
+  REQUIRE(ref.get() == parent);
+  REQUIRE(nested.get() == parent);
+
+  // The child's own bean takes precedence, for its descendants too
+  const auto own = child->getNewInstance<Config>();
+  REQUIRE(ref.get() == own);
+  REQUIRE(nested.get() == own);
+  REQUIRE(ac->getFirstBeanTyped<Config>() == parent);
+}
+
+TEST_CASE("Child context property handles follow the parent") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto properties = source.get();
+  ac->registerPropertySource(std::move(source));
+  properties->setProperty("tenant.limit", 10);
+
+  const auto child = ac->createChildContext("tenant");
+  const auto grandchild = child->createChildContext("request");
+  auto &limit = grandchild->getPropertyHandle<int>("tenant.limit");
+  REQUIRE(limit.get() == 10);
+
+  properties->setProperty("tenant.limit", 20);
+  REQUIRE(limit.get() == 20);
+
+  auto overrides = std::make_unique<framework::impl::MapPropertySource>();
+  overrides->setProperty("tenant.limit", 5);
+  child->registerPropertySource(std::move(overrides));
+  REQUIRE(limit.get() == 5);
+
+  // Shadowed by the child now
+  properties->setProperty("tenant.limit", 30);
+  REQUIRE(limit.get() == 5);
+}
+
+TEST_CASE("Child context placeholders expand through the parent") {
+  const auto ac = createApplicationContext(__FUNCTION__);
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto properties = source.get();
+  ac->registerPropertySource(std::move(source));
+  properties->setProperty("tenant.limit", 10);
+
+  const auto child = ac->createChildContext("tenant");
+  auto overrides = std::make_unique<framework::impl::MapPropertySource>();
+  overrides->setProperty("tenant.banner", "limit ${tenant.limit}, owner ${tenant.owner:none}");
+  child->registerPropertySource(std::move(overrides));
+  REQUIRE(child->getPropertyAsString("tenant.banner") == "limit 10, owner none");
+
+  // The expanded value follows the keys it was expanded from, in the parent too
+  properties->setProperty("tenant.limit", 20);
+  properties->setProperty("tenant.owner", "ops");
+  REQUIRE(child->getPropertyAsString("tenant.banner") == "limit 20, owner ops");
+}
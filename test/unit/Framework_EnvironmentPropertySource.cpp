@@ -1,7 +1,12 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include "compositing_property_resolver.h"
 #include "property_sources/environment_property_source.h"
 
+#include <memory>
+#include <string>
+#include <vector>
+
 TEST_CASE("Read env to source") {
 #ifdef _WIN32
   _putenv_s("TEST", "allo");
@@ -18,3 +23,84 @@ TEST_CASE("Read env to source") {
   REQUIRE(value == "allo");
 }
 
+
+TEST_CASE("Snapshot of the environment") {
+  using framework::impl::EnvironmentPropertySource;
+#ifdef _WIN32
+  _putenv_s("SNAPSHOT_DB_HOST", "localhost");
+  _putenv_s("OTHER_VALUE", "1");
+#else
+  setenv("SNAPSHOT_DB_HOST", "localhost", 1);
+  setenv("OTHER_VALUE", "1", 1);
+#endif
+
+  EnvironmentPropertySource propsource(EnvironmentPropertySource::Mode::SNAPSHOT, "snapshot.");
+
+  std::vector<std::string> changes;
+  propsource.addValueWatcher([&changes](std::string_view name) { changes.emplace_back(name); });
+
+  SECTION("Any spelling of the name finds the variable") {
+    REQUIRE(propsource.containsProperty("snapshot.db.host"));
+    REQUIRE(propsource.containsProperty("SNAPSHOT_DB_HOST"));
+    REQUIRE(propsource.containsProperty("snapshot.db-.host"));
+    REQUIRE(std::get<std::string>(propsource.getProperty("Snapshot.Db.Host")) == "localhost");
+    REQUIRE_FALSE(propsource.containsProperty("snapshot.db"));
+  }
+
+  SECTION("Variables outside the prefix are left out") {
+    REQUIRE_FALSE(propsource.containsProperty("other.value"));
+    REQUIRE(EnvironmentPropertySource(EnvironmentPropertySource::Mode::SNAPSHOT).containsProperty("other.value"));
+  }
+
+  SECTION("Changes are only seen after a refresh") {
+#ifdef _WIN32
+    _putenv_s("SNAPSHOT_DB_HOST", "remote");
+    _putenv_s("SNAPSHOT_DB_PORT", "5432");
+#else
+    setenv("SNAPSHOT_DB_HOST", "remote", 1);
+    setenv("SNAPSHOT_DB_PORT", "5432", 1);
+#endif
+    REQUIRE(std::get<std::string>(propsource.getProperty("snapshot.db.host")) == "localhost");
+    REQUIRE_FALSE(propsource.containsProperty("snapshot.db.port"));
+
+    propsource.refresh();
+    REQUIRE(std::get<std::string>(propsource.getProperty("snapshot.db.host")) == "remote");
+    REQUIRE(std::get<std::string>(propsource.getProperty("snapshot.db.port")) == "5432");
+
+    // Any spelling may be cached, every property is reported changed
+    REQUIRE(changes == std::vector<std::string>{""});
+
+    changes.clear();
+    propsource.refresh();
+    REQUIRE(changes.empty());
+  }
+}
+
+TEST_CASE("Resolvers drop every spelling of a refreshed variable") {
+  using framework::impl::EnvironmentPropertySource;
+#ifdef _WIN32
+  _putenv_s("REFRESH_DB_HOST", "localhost");
+#else
+  setenv("REFRESH_DB_HOST", "localhost", 1);
+#endif
+
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<EnvironmentPropertySource>(EnvironmentPropertySource::Mode::SNAPSHOT, "refresh.");
+  const auto propsource = source.get();
+  resolver.registerPropertySource(std::move(source));
+
+  REQUIRE(resolver.getPropertyAsString("refresh.db.host") == "localhost");
+  REQUIRE(resolver.getPropertyAsString("REFRESH_DB_HOST") == "localhost");
+  REQUIRE(resolver.getPropertyAsString("Refresh.Db.Host") == "localhost");
+
+#ifdef _WIN32
+  _putenv_s("REFRESH_DB_HOST", "remote");
+#else
+  setenv("REFRESH_DB_HOST", "remote", 1);
+#endif
+  propsource->refresh();
+
+  REQUIRE(resolver.getPropertyAsString("refresh.db.host") == "remote");
+  REQUIRE(resolver.getPropertyAsString("REFRESH_DB_HOST") == "remote");
+  REQUIRE(resolver.getPropertyAsString("Refresh.Db.Host") == "remote");
+}
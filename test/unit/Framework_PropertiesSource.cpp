@@ -1,7 +1,20 @@
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <latch>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
 
+#include "compositing_property_resolver.h"
+#include "property_change_dispatcher.h"
+#include "property_sources/map_property_source.h"
 #include "property_sources/property_file_property_source.h"
 #include "sproutpp/property_source.h"
 
@@ -34,3 +47,442 @@ TEST_CASE("Can read simple properties file") {
   REQUIRE(std::get<std::string>(propsource.getProperty("MULTISPACE")) == "de sk");
   
 }
+
+namespace {
+class CountingPropertySource : public framework::impl::MapPropertySource {
+public:
+  mutable int lookups = 0;
+
+  Value getProperty(std::string_view propertyName) const override {
+    lookups++;
+    return MapPropertySource::getProperty(propertyName);
+  }
+};
+}// namespace
+
+TEST_CASE("Resolved properties are cached until they change") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<CountingPropertySource>();
+  const auto counting = source.get();
+  counting->setProperty("TEST", "allo");
+  resolver.registerPropertySource(std::move(source));
+  counting->lookups = 0;
+
+  REQUIRE(resolver.getPropertyAsString("TEST") == "allo");
+  REQUIRE(resolver.getPropertyAsString("TEST") == "allo");
+  REQUIRE(counting->lookups == 1);
+
+  // Misses are cached too
+  REQUIRE(!resolver.containsProperty("MISSING"));
+  REQUIRE(!resolver.containsProperty("MISSING"));
+  REQUIRE(counting->lookups == 2);
+
+  // A change only drops the name that changed
+  counting->setProperty("TEST", "world");
+  REQUIRE(resolver.getPropertyAsString("TEST") == "world");
+  REQUIRE(!resolver.containsProperty("MISSING"));
+  REQUIRE(counting->lookups == 3);
+
+  counting->setProperty("MISSING", 42);
+  REQUIRE(resolver.getPropertyAsInt("MISSING") == 42);
+
+  // A new source may shadow anything
+  auto overrides = std::make_unique<framework::impl::MapPropertySource>();
+  overrides->setProperty("TEST", "shadowed");
+  resolver.registerPropertySource(std::move(overrides));
+  REQUIRE(resolver.getPropertyAsString("TEST") == "shadowed");
+}
+
+namespace {
+class StaticMapPropertySource : public framework::impl::MapPropertySource {
+public:
+  bool isStatic() const override { return true; }
+};
+}// namespace
+
+TEST_CASE("Flattened static sources keep their precedence") {
+  writePropertiesFile();
+
+  framework::impl::CompositingPropertyResolver resolver;
+  resolver.registerPropertySource(std::make_unique<framework::impl::PropertyFilePropertySource>("test.properties"));
+
+  auto profile = std::make_unique<StaticMapPropertySource>();
+  profile->setProperty("ILO", "profile");
+  profile->setProperty("PROFILE", "yes");
+  resolver.registerPropertySource(std::move(profile));
+
+  auto dynamic = std::make_unique<framework::impl::MapPropertySource>();
+  const auto dynamicSource = dynamic.get();
+  dynamic->setProperty("PROFILE", "dynamic");
+  dynamic->setProperty("MULTILINE", "dynamic");
+  resolver.registerPropertySource(std::move(dynamic));
+
+  auto top = std::make_unique<StaticMapPropertySource>();
+  top->setProperty("MULTILINE", "top");
+  resolver.registerPropertySource(std::move(top));
+
+  resolver.flattenStaticSources();
+
+  REQUIRE(resolver.getPropertyAsString("TEST") == "allo");
+  REQUIRE(resolver.getPropertyAsString("ILO") == "profile");
+  REQUIRE(resolver.getPropertyAsString("PROFILE") == "dynamic");
+  REQUIRE(resolver.getPropertyAsString("MULTILINE") == "top");
+  REQUIRE(!resolver.containsProperty("MISSING"));
+
+  // Dynamic sources still notify
+  dynamicSource->setProperty("TEST", "dynamic");
+  REQUIRE(resolver.getPropertyAsString("TEST") == "dynamic");
+}
+
+TEST_CASE("Property handles follow their property") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto dynamicSource = source.get();
+  dynamicSource->setProperty("limit", "10");
+  dynamicSource->setProperty("enabled", "true");
+  resolver.registerPropertySource(std::move(source));
+
+  auto &limit = resolver.getPropertyHandle<int>("limit", 1);
+  auto &enabled = resolver.getPropertyHandle<bool>("enabled");
+  auto &ratio = resolver.getPropertyHandle<double>("ratio", 0.5);
+  REQUIRE(limit.get() == 10);
+  REQUIRE(enabled.get());
+  REQUIRE(*ratio == 0.5);
+
+  // Bound once per type and default value
+  REQUIRE(&resolver.getPropertyHandle<int>("limit", 1) == &limit);
+  REQUIRE(&resolver.getPropertyHandle<int>("limit", 2) != &limit);
+  REQUIRE(static_cast<const void *>(&resolver.getPropertyHandle<long>("limit", 1)) != &limit);
+
+  dynamicSource->setProperty("limit", 20);
+  dynamicSource->setProperty("enabled", "false");
+  REQUIRE(limit.get() == 20);
+  REQUIRE(!enabled.get());
+
+  // Unparsable and removed values fall back to the default
+  dynamicSource->setProperty("limit", "many");
+  REQUIRE(limit.get() == 1);
+  dynamicSource->setProperty("limit", "30");
+  dynamicSource->removeProperty("limit");
+  REQUIRE(limit.get() == 1);
+
+  auto overrides = std::make_unique<framework::impl::MapPropertySource>();
+  overrides->setProperty("ratio", "0.25");
+  resolver.registerPropertySource(std::move(overrides));
+  REQUIRE(ratio.get() == 0.25);
+}
+
+TEST_CASE("Property views borrow the resolved value") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto dynamicSource = source.get();
+  dynamicSource->setProperty("name", "a name long enough to be allocated on the heap");
+  dynamicSource->setProperty("limit", " +12");
+  resolver.registerPropertySource(std::move(source));
+
+  const auto first = resolver.getPropertyView("name");
+  const auto second = resolver.getPropertyView("name");
+  REQUIRE(std::holds_alternative<std::string_view>(*first));
+  REQUIRE(std::get<std::string_view>(*first) == "a name long enough to be allocated on the heap");
+  REQUIRE(std::get<std::string_view>(*first).data() == std::get<std::string_view>(*second).data());
+  REQUIRE(std::holds_alternative<std::monostate>(*resolver.getPropertyView("missing")));
+
+  // Same parsing as std::stoi
+  REQUIRE(resolver.getPropertyAsInt("limit") == 12);
+  dynamicSource->setProperty("limit", "none");
+  REQUIRE_THROWS_AS(resolver.getPropertyAsInt("limit"), std::invalid_argument);
+
+  dynamicSource->setProperty("name", "renamed");
+  REQUIRE(std::get<std::string_view>(*resolver.getPropertyView("name")) == "renamed");
+
+  // Views taken before the change keep the value they were created with
+  REQUIRE(std::get<std::string_view>(*first) == "a name long enough to be allocated on the heap");
+}
+
+TEST_CASE("Concurrent property lookups see changes made by other threads") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto dynamicSource = source.get();
+  dynamicSource->setProperty("counter", 0);
+  dynamicSource->setProperty("name", "a name long enough to be allocated on the heap");
+  resolver.registerPropertySource(std::move(source));
+  resolver.enableConcurrentPropertyAccess();
+
+  std::atomic<bool> done{false};
+  std::vector<std::thread> readers;
+  std::atomic<int> failures{0};
+  for (int t = 0; t < 4; t++) {
+    readers.emplace_back([&] {
+      int last = 0;
+      while (!done.load()) {
+        // Values only grow, and untouched properties keep resolving
+        const auto counter = resolver.getPropertyAsInt("counter");
+        if (counter < last || resolver.getPropertyAsString("name").size() != 46 || resolver.containsProperty("missing")) {
+          failures++;
+        }
+        last = counter;
+      }
+    });
+  }
+
+  for (int i = 1; i <= 200; i++) {
+    dynamicSource->setProperty("counter", i);
+  }
+  done = true;
+  for (auto &reader: readers) {
+    reader.join();
+  }
+
+  REQUIRE(failures.load() == 0);
+  REQUIRE(resolver.getPropertyAsInt("counter") == 200);
+}
+
+TEST_CASE("Property watchers receive batches of the changes they watch") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<framework::impl::MapPropertySource>();
+  const auto dynamicSource = source.get();
+  resolver.registerPropertySource(std::move(source));
+
+  std::mutex mutex;
+  std::vector<std::vector<std::string>> limitBatches;
+  std::vector<std::string> dbNames;
+  const auto writer = std::this_thread::get_id();
+  std::atomic<bool> onWriterThread{false};
+  // The first callback holds the dispatcher until every other change is queued
+  std::latch delivering{1};
+  std::latch queued{1};
+
+  const auto limitWatcher = resolver.watchProperty("service.limit", [&](std::span<const std::string> names) {
+    onWriterThread = onWriterThread || std::this_thread::get_id() == writer;
+    bool first = false;
+    {
+      const std::lock_guard lock(mutex);
+      limitBatches.emplace_back(names.begin(), names.end());
+      first = limitBatches.size() == 1;
+    }
+    if (first) {
+      delivering.count_down();
+      queued.wait();
+    }
+  });
+  resolver.watchProperties("db.", [&](std::span<const std::string> names) {
+    const std::lock_guard lock(mutex);
+    dbNames.insert(dbNames.end(), names.begin(), names.end());
+  });
+
+  dynamicSource->setProperty("service.limit", 0);
+  delivering.wait();
+  for (int i = 1; i < 100; i++) {
+    dynamicSource->setProperty("service.limit", i);
+  }
+  dynamicSource->setProperty("db.url", "localhost");
+  dynamicSource->setProperty("service.name", "ignored");
+  queued.count_down();
+  resolver.flushPropertyChanges();
+
+  {
+    const std::lock_guard lock(mutex);
+    // The 99 changes queued while the first batch was delivered are coalesced into one
+    REQUIRE(limitBatches.size() == 2);
+    for (const auto &batch: limitBatches) {
+      REQUIRE(batch == std::vector<std::string>{"service.limit"});
+    }
+    REQUIRE(dbNames == std::vector<std::string>{"db.url"});
+  }
+  REQUIRE(!onWriterThread);
+
+  // Removed watchers are not called anymore
+  resolver.removePropertyWatcher(limitWatcher);
+  const auto batches = limitBatches.size();
+  dynamicSource->setProperty("service.limit", 1000);
+  resolver.flushPropertyChanges();
+  REQUIRE(limitBatches.size() == batches);
+
+  // A new source may change anything: an empty batch
+  resolver.registerPropertySource(std::make_unique<framework::impl::MapPropertySource>());
+  resolver.flushPropertyChanges();
+  const std::lock_guard lock(mutex);
+  REQUIRE(dbNames == std::vector<std::string>{"db.url"});
+}
+
+TEST_CASE("A watcher may stop its dispatcher") {
+  std::atomic<int> calls{0};
+  {
+    framework::impl::PropertyChangeDispatcher dispatcher;
+    dispatcher.addWatcher(nullptr, "service.limit", false, [&](std::span<const std::string>) {
+      calls++;
+      dispatcher.stop();
+    });
+    dispatcher.propertyChanged(nullptr, "service.limit");
+    dispatcher.flush();
+
+    // Nothing is delivered once stopped, and the destructor joins the thread
+    dispatcher.propertyChanged(nullptr, "service.limit");
+  }
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("Watchers are stopped before the resolver state goes away") {
+  std::atomic<int> calls{0};
+  std::latch delivering{1};
+  {
+    framework::impl::CompositingPropertyResolver resolver;
+    auto source = std::make_unique<framework::impl::MapPropertySource>();
+    const auto dynamicSource = source.get();
+    resolver.registerPropertySource(std::move(source));
+    resolver.enableConcurrentPropertyAccess();
+
+    resolver.watchProperty("service.limit", [&](std::span<const std::string>) {
+      if (calls++ == 0) {
+        delivering.count_down();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      }
+      // Reads the cache of the resolver being destroyed
+      resolver.getPropertyAsInt("service.limit");
+    });
+    dynamicSource->setProperty("service.limit", 1);
+    delivering.wait();
+
+    // Still pending when the resolver is destroyed, it is dropped rather than delivered late
+    dynamicSource->setProperty("service.limit", 2);
+  }
+  REQUIRE(calls == 1);
+}
+
+TEST_CASE("Resolvers following each other notify their watchers from one thread") {
+  struct ChildResolver : framework::impl::CompositingPropertyResolver {
+    using CompositingPropertyResolver::followResolver;
+  };
+
+  framework::impl::CompositingPropertyResolver parent;
+  auto parentSource = std::make_unique<framework::impl::MapPropertySource>();
+  const auto parentProperties = parentSource.get();
+  parent.registerPropertySource(std::move(parentSource));
+
+  ChildResolver child;
+  child.followResolver(parent);
+  auto childSource = std::make_unique<framework::impl::MapPropertySource>();
+  const auto childProperties = childSource.get();
+  child.registerPropertySource(std::move(childSource));
+
+  std::mutex mutex;
+  std::vector<std::thread::id> parentCalls;
+  std::vector<std::thread::id> childCalls;
+  parent.watchProperty("service.limit", [&](std::span<const std::string>) {
+    const std::lock_guard lock(mutex);
+    parentCalls.push_back(std::this_thread::get_id());
+  });
+  child.watchProperty("service.limit", [&](std::span<const std::string>) {
+    const std::lock_guard lock(mutex);
+    childCalls.push_back(std::this_thread::get_id());
+  });
+
+  // Relayed to the child, on the same dispatcher
+  parentProperties->setProperty("service.limit", 1);
+  parent.flushPropertyChanges();
+  {
+    const std::lock_guard lock(mutex);
+    REQUIRE(parentCalls.size() == 1);
+    REQUIRE(childCalls.size() == 1);
+    REQUIRE(parentCalls.front() == childCalls.front());
+  }
+
+  // A change of the child only reaches the watchers of the child
+  childProperties->setProperty("service.limit", 2);
+  child.flushPropertyChanges();
+  const std::lock_guard lock(mutex);
+  REQUIRE(parentCalls.size() == 1);
+  REQUIRE(childCalls.size() == 2);
+}
+
+TEST_CASE("Placeholders are expanded and follow the keys they refer to") {
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<CountingPropertySource>();
+  const auto counting = source.get();
+  counting->setProperty("db.host", "localhost");
+  counting->setProperty("db.url", "jdbc://${db.host}:${db.port:5432}/${db.name}");
+  counting->setProperty("db.pool", "${db.url}?size=${pool.size}");
+  counting->setProperty("pool.size", 8);
+  counting->setProperty("other", "${other.missing:none}");
+  resolver.registerPropertySource(std::move(source));
+
+  REQUIRE(resolver.getPropertyAsString("db.url") == "jdbc://localhost:5432/${db.name}");
+  REQUIRE(resolver.getPropertyAsString("db.pool") == "jdbc://localhost:5432/${db.name}?size=8");
+  REQUIRE(resolver.getPropertyAsString("other") == "none");
+  REQUIRE(std::get<std::string_view>(*resolver.getPropertyView("db.pool")) == "jdbc://localhost:5432/${db.name}?size=8");
+
+  // Only the values expanded from the changed key are looked up again
+  counting->lookups = 0;
+  counting->setProperty("db.name", "app");
+  REQUIRE(resolver.getPropertyAsString("db.pool") == "jdbc://localhost:5432/app?size=8");
+  REQUIRE(resolver.getPropertyAsString("other") == "none");
+  REQUIRE(counting->lookups == 1);
+
+  counting->setProperty("db.host", "remote");
+  REQUIRE(resolver.getPropertyAsString("db.url") == "jdbc://remote:5432/app");
+  REQUIRE(resolver.getPropertyAsString("db.pool") == "jdbc://remote:5432/app?size=8");
+
+  // A changed template is compiled again
+  counting->setProperty("db.url", "${db.host}");
+  REQUIRE(resolver.getPropertyAsString("db.pool") == "remote?size=8");
+
+  // Handles of the referrers are updated too
+  const auto &size = resolver.getPropertyHandle<int>("pool.limit", 0);
+  counting->setProperty("pool.limit", "${pool.size}");
+  REQUIRE(size.get() == 8);
+  counting->setProperty("pool.size", 16);
+  REQUIRE(size.get() == 16);
+
+  // Cycles stay unresolved
+  counting->setProperty("cycle.a", "${cycle.b}");
+  counting->setProperty("cycle.b", "${cycle.a}");
+  REQUIRE(resolver.getPropertyAsString("cycle.a") == "${cycle.a}");
+}
+
+TEST_CASE("Typed getters read values parsed once") {
+  using framework::PropertyError;
+  using namespace std::chrono_literals;
+
+  framework::impl::CompositingPropertyResolver resolver;
+  auto source = std::make_unique<CountingPropertySource>();
+  const auto counting = source.get();
+  counting->setProperty("port", "8080");
+  counting->setProperty("ratio", "0.75");
+  counting->setProperty("enabled", "true");
+  counting->setProperty("timeout", "30s");
+  counting->setProperty("buffer", "64KB");
+  counting->setProperty("huge", "99999999999999999999");
+  counting->setProperty("retries", 3);
+  counting->setProperty("name", "service");
+  resolver.registerPropertySource(std::move(source));
+  counting->lookups = 0;
+
+  REQUIRE(resolver.getPropertyAsInt64("port") == 8080);
+  REQUIRE(resolver.getPropertyAsDouble("port") == 8080.0);
+  REQUIRE(resolver.getPropertyAsByteSize("port") == 8080U);
+  REQUIRE(resolver.getPropertyAsDuration("port") == 8080ms);
+  REQUIRE(resolver.getPropertyAsInt("port") == 8080);
+  REQUIRE(counting->lookups == 1);
+
+  REQUIRE(resolver.getPropertyAsDouble("ratio") == 0.75);
+  REQUIRE(resolver.getPropertyAsInt64("ratio").error() == PropertyError::INVALID);
+  REQUIRE(resolver.getPropertyAsBool("enabled") == true);
+  REQUIRE(resolver.getPropertyAsDuration("timeout") == 30s);
+  REQUIRE(resolver.getPropertyAsByteSize("buffer") == 64U * 1024U);
+  REQUIRE(resolver.getPropertyAsInt64("huge").error() == PropertyError::OUT_OF_RANGE);
+  REQUIRE(resolver.getPropertyAsInt64("retries") == 3);
+  REQUIRE(resolver.getPropertyAsDuration("retries") == 3ms);
+  REQUIRE(resolver.getPropertyAsBool("name").error() == PropertyError::INVALID);
+  REQUIRE(resolver.getPropertyAsDuration("name").error() == PropertyError::INVALID);
+  REQUIRE(resolver.getPropertyAsInt64("missing").error() == PropertyError::MISSING);
+
+  // The raw string is still there, and the parsed value follows changes
+  REQUIRE(resolver.getPropertyAsString("timeout") == "30s");
+  counting->setProperty("timeout", "250ms");
+  REQUIRE(resolver.getPropertyAsDuration("timeout") == 250ms);
+
+  // getPropertyAsInt keeps the std::stoi behavior for what is not an int
+  REQUIRE(resolver.getPropertyAsInt("missing", 7) == 7);
+  REQUIRE_THROWS_AS(resolver.getPropertyAsInt("name"), std::invalid_argument);
+  REQUIRE_THROWS_AS(resolver.getPropertyAsInt("huge"), std::out_of_range);
+}